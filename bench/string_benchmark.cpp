@@ -0,0 +1,165 @@
+// Times the core/string scanners against the standard library and a scalar tokenizer, on OBJ-like text.
+// Build with NIFTYLIB_BUILD_BENCHMARKS=ON, once with NIFTYLIB_ENABLE_AVX2 and once without, to compare paths.
+
+#include "core/string.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+constexpr int runs = 20;
+
+std::string MakeObjText(size_t line_count)
+{
+	std::mt19937						  random(42);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	std::uniform_int_distribution<int>	  index(1, 100000);
+
+	std::string text;
+	for (size_t i = 0; i < line_count; i++)
+	{
+		if (i % 2 == 0)
+		{
+			float x = coordinate(random);
+			float y = coordinate(random);
+			float z = coordinate(random);
+			text += "v " + std::to_string(x) + " " + std::to_string(y) + " " + std::to_string(z) + "\n";
+		}
+		else
+		{
+			text += "f";
+			for (int corner = 0; corner < 3; corner++)
+			{
+				int vertex = index(random);
+				int uv	   = index(random);
+				int normal = index(random);
+				text += " " + std::to_string(vertex) + "/" + std::to_string(uv) + "/" + std::to_string(normal);
+			}
+			text += "\n";
+		}
+	}
+	return text;
+}
+
+// The word splitting nft::string replaced, one character at a time
+void ScalarSplitWhitespace(std::string_view text, std::vector<std::string_view>& tokens)
+{
+	tokens.clear();
+	size_t start = std::string_view::npos;
+	for (size_t pos = 0; pos <= text.size(); pos++)
+	{
+		bool space = pos == text.size() || text[pos] == ' ' || (text[pos] >= '\t' && text[pos] <= '\r');
+		if (space && start != std::string_view::npos)
+		{
+			tokens.push_back(text.substr(start, pos - start));
+			start = std::string_view::npos;
+		}
+		else if (!space && start == std::string_view::npos)
+			start = pos;
+	}
+}
+
+// Best of several runs, in milliseconds; result keeps the work from being optimized away and is checked
+double Time(const std::function<size_t()>& work, size_t& result)
+{
+	double best = 0.0;
+	for (int run = 0; run < runs; run++)
+	{
+		auto   start   = std::chrono::steady_clock::now();
+		result		   = work();
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best		   = run == 0 ? elapsed : std::min(best, elapsed);
+	}
+	return best;
+}
+
+void Compare(const char* name, const std::function<size_t()>& baseline, const std::function<size_t()>& candidate)
+{
+	size_t baseline_result	= 0;
+	size_t candidate_result = 0;
+	double baseline_time	= Time(baseline, baseline_result);
+	double candidate_time	= Time(candidate, candidate_result);
+	std::printf("%-20s %8.3f ms -> %8.3f ms (%.2fx)%s\n",
+				name,
+				baseline_time,
+				candidate_time,
+				baseline_time / candidate_time,
+				baseline_result == candidate_result ? "" : "  RESULTS DIFFER");
+}
+}	 // namespace
+
+int main()
+{
+	std::string		 storage = MakeObjText(200000);
+	std::string_view text	 = storage;
+
+#if defined(__AVX2__)
+	std::puts("core/string built with AVX2");
+#else
+	std::puts("core/string built without AVX2");
+#endif
+	std::printf("%zu KB of OBJ text, best of %d runs\n", text.size() / 1024, runs);
+
+	auto count = [&](auto find)
+	{
+		return [=]()
+		{
+			size_t matches = 0;
+			for (size_t pos = find(0); pos != std::string_view::npos; pos = find(pos + 1))
+				matches++;
+			return matches;
+		};
+	};
+
+	Compare("FindChar",
+			count([=](size_t pos) { return text.find('\n', pos); }),
+			count([=](size_t pos) { return nft::string::FindChar(text, '\n', pos); }));
+	Compare("Find",
+			count([=](size_t pos) { return text.find("\nf ", pos); }),
+			count([=](size_t pos) { return nft::string::Find(text, "\nf ", pos); }));
+	Compare("FindWhitespace",
+			count([=](size_t pos) { return text.find_first_of(" \t\n\v\f\r", pos); }),
+			count([=](size_t pos) { return nft::string::FindWhitespace(text, pos); }));
+
+	std::vector<std::string_view> tokens;
+	Compare(
+		"SplitWhitespace",
+		[&]()
+		{
+			ScalarSplitWhitespace(text, tokens);
+			return tokens.size();
+		},
+		[&]()
+		{
+			nft::string::SplitWhitespace(text, tokens);
+			return tokens.size();
+		});
+	Compare(
+		"Tokenizer",
+		[&]()
+		{
+			size_t			 lines = 0;
+			std::string_view rest  = text;
+			for (size_t end = rest.find('\n'); end != std::string_view::npos; end = rest.find('\n'))
+			{
+				rest = rest.substr(end + 1);
+				lines++;
+			}
+			return lines + (rest.empty() ? 0 : 1);
+		},
+		[&]()
+		{
+			size_t lines = 0;
+			for (std::string_view line : nft::string::Tokenizer(text, "\n", true))
+				lines += line.empty() ? 0 : 1;
+			return lines;
+		});
+	return 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <mutex>
 #include <optional>
 #include <print>
 
@@ -190,6 +191,7 @@ class Logger
 	std::string	 name			= "";
 	DisplayFlags display_flags	= Log::Flags::Default;
 	bool		 verbose		= false;
+	std::mutex	 print_mutex;	 // Messages are printed in pieces; keeps lines from worker threads whole
 
 	void Print(const std::string& message,
 			   const std::string& extra,
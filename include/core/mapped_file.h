@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace nft
+{
+
+// Read-only memory mapping of a whole file. The mapping stays valid for the lifetime of the object,
+// so views handed out by GetView() must not outlive it.
+class MappedFile
+{
+  public:
+	MappedFile() = default;
+	MappedFile(const std::string& file_path);
+	~MappedFile();
+
+	// Disable copy
+	MappedFile(const MappedFile&)			 = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Enable move
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool Open(const std::string& file_path);
+	void Close();
+
+	bool			 IsOpen() const { return is_open; }
+	const char*		 GetData() const { return data; }
+	size_t			 GetSize() const { return size; }
+	std::string_view GetView() const { return std::string_view(data, size); }
+
+  private:
+	const char* data	= nullptr;
+	size_t		size	= 0;
+	bool		is_open = false;
+
+#ifdef _WIN32
+	void* file_handle	 = nullptr;
+	void* mapping_handle = nullptr;
+#else
+	int file_descriptor = -1;
+#endif
+};
+
+}	 // namespace nft
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include <glm/glm.hpp>
@@ -12,13 +17,114 @@ namespace nft::parse
 class ObjLoader
 {
   public:
-	ObjLoader(const std::string& file_dir, const std::string& file_name);
+	enum class ParseMode
+	{
+		Stream,	   // Read line by line through std::getline
+		Mapped,	   // Memory-map the file and tokenize in place
+		Parallel	// Memory-map the file and parse line-aligned chunks on worker threads
+	};
+
+	// Parse throughput of the last load (OBJ plus any referenced MTL files)
+	struct Stats
+	{
+		size_t bytes   = 0;
+		double seconds = 0.0;
+
+		double GetThroughput() const { return seconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0; }	 // MB/s
+	};
+
+	// Run of consecutive indices drawn with the same usemtl material
+	struct MaterialRange
+	{
+		uint32_t first_index;
+		uint32_t index_count;
+		uint32_t material_id;	 // Order of first use of the usemtl name, 0 before any usemtl
+	};
+
+	// Block of complete triangles emitted by the streaming constructor. Indices are local to the chunk and
+	// the spans are only valid for the duration of the sink call.
+	struct MeshChunk
+	{
+		std::span<const float>		   vertices;
+		std::span<const uint32_t>	   indices;
+		std::span<const MaterialRange> material_ranges;	   // first_index is relative to the chunk
+	};
+
+	using ChunkSink = std::function<void(const MeshChunk&)>;
+
+	ObjLoader(const std::string& file_dir, const std::string& file_name, ParseMode mode = ParseMode::Mapped);
+
+	// Streams the mesh to sink in chunks of at most max_chunk_vertices vertices instead of building it in memory.
+	// Only the v/vt/vn attribute pools grow with the model, since faces may reference any earlier attribute.
+	// ParseMode::Parallel is parsed as ParseMode::Mapped in this mode.
+	ObjLoader(const std::string& file_dir,
+			  const std::string& file_name,
+			  ChunkSink			 sink,
+			  size_t			 max_chunk_vertices,
+			  ParseMode			 mode = ParseMode::Mapped);
 	~ObjLoader() = default;
 
 	std::unique_ptr<std::vector<float>>	   GetVertices();
 	std::unique_ptr<std::vector<uint32_t>> GetIndices();
+	const std::vector<MaterialRange>&	   GetMaterialRanges() const { return material_ranges; }
+	// Paths of the MTL files the OBJ referenced, which the parsed colors depend on
+	const std::vector<std::string>&		   GetMaterialLibraries() const { return material_libraries; }
+	const Stats&						   GetStats() const { return stats; }
 
   private:
+	using Words = std::vector<std::string_view>;
+
+	// Raw "v/vt/vn" indices as written in the file: 1-based, negative for relative, 0 if absent
+	struct Corner
+	{
+		int32_t v  = 0;
+		int32_t vt = 0;
+		int32_t vn = 0;
+
+		bool operator==(const Corner&) const = default;
+	};
+
+	// Resolved corner plus material, packed into two words for hashing and comparison
+	struct CornerKey
+	{
+		uint64_t position_texcoord = 0;	   // v | vt << 32
+		uint64_t normal_material   = 0;	   // vn | material << 32
+
+		bool operator==(const CornerKey&) const = default;
+	};
+
+	// Flat open-addressing (linear probing) map from corner key to vertex index.
+	// A zero position_texcoord marks an empty slot; resolved positions are 1-based so it never occurs as a key.
+	class CornerTable
+	{
+	  public:
+		void Reserve(size_t count);
+		void Clear();	 // Removes all keys but keeps the capacity
+
+		// Returns the index stored for key, inserting next_index if the key is new
+		std::pair<uint32_t, bool> FindOrInsert(const CornerKey& key, uint32_t next_index);
+		size_t					  GetSize() const { return size; }
+
+	  private:
+		struct Slot
+		{
+			CornerKey key;
+			uint32_t  index;
+		};
+
+		std::vector<Slot> slots;	// Capacity is always a power of two
+		size_t			  size = 0;
+
+		static size_t Hash(const CornerKey& key);
+		void		  Rehash(size_t capacity);
+	};
+
+	// Parse result of one line-aligned slice of a file, defined in parse_obj.cpp
+	struct Chunk;
+
+	ParseMode mode;
+	Stats	  stats;
+
 	std::unique_ptr<std::vector<float>>	   vertices;
 	std::unique_ptr<std::vector<uint32_t>> indices;
 	std::vector<glm::vec3>	   v;
@@ -26,18 +132,37 @@ class ObjLoader
 	std::vector<glm::vec2>	   vt;
 	glm::mat4								   pre_transform = glm::mat4(1.0f);	   // Pre-transform matrix
 
-	std::unordered_map<std::string, uint32_t> index_history;
+	CornerTable								   index_history;
 	std::unordered_map<std::string, glm::vec3> colors;
+	std::unordered_map<std::string, uint32_t>  material_ids;	// usemtl name -> id used in corner keys, 0 before any usemtl
+	uint32_t								   material_id = 0;
+	std::vector<MaterialRange>				   material_ranges;
+	std::vector<std::string>				   material_libraries;
+
+	ChunkSink sink;
+	size_t	  max_chunk_vertices = 0;
 	glm::vec3								   brush_color = { 1.0f, 1.0f, 1.0f };	  // Default white color
 
 	void ParseObjFile(const std::string& file_dir, const std::string& file_name);
 	void ParseMtlFile(const std::string& file_dir, const std::string& file_name);
 
-	void ReadVertexData(const std::vector<std::string>& words);
-	void ReadTextureCoordData(const std::vector<std::string>& words);
-	void ReadNormalData(const std::vector<std::string>& words);
-	void ReadFaceData(const std::vector<std::string>& words);
-	void ReadCorner(const std::string& vertex_description);
+	template<typename Fn>
+	bool ForEachLine(const std::string& file_path, Fn&& fn);
+
+	void ParseMtlRecord(const Words& words, std::string& material_name);
+
+	// Chunk parsing only reads pre_transform, so it is safe to run on worker threads
+	void ParseChunk(Chunk& chunk, std::string_view text) const;
+	void ParseObjRecord(Chunk& chunk, const Words& words) const;
+	void ReadVertexData(Chunk& chunk, const Words& words) const;
+	void ReadTextureCoordData(Chunk& chunk, const Words& words) const;
+	void ReadNormalData(Chunk& chunk, const Words& words) const;
+	void ReadFaceData(Chunk& chunk, const Words& words) const;
+
+	// Merging runs on the calling thread in file order, so material state and index numbering are deterministic
+	void MergeChunk(const std::string& file_dir, Chunk& chunk);
+	void ReadCorner(const Corner& corner);	  // Expects resolved indices
+	void FlushChunk();
 
 };
-}	 // namespace nft::parse
\ No newline at end of file
+}	 // namespace nft::parse
@@ -2,10 +2,76 @@
 
 //#include "NiftyUtil.h"
 
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace nft::string
 {
-std::vector<std::string> split(std::string string, std::string delimiter);
-}	 // namespace nft::String
\ No newline at end of file
+// Copying split, kept for callers that want owned strings; prefer Tokenizer
+std::vector<std::string> split(std::string_view string, std::string_view delimiter);
+
+// These search from pos and return std::string_view::npos when nothing matches. They scan 32 or 16 bytes at a
+// time with AVX2 or SSE2 when the build targets them (AVX2 needs NIFTYLIB_ENABLE_AVX2), and fall back to scalar
+// code (memchr) otherwise.
+size_t FindChar(std::string_view text, char c, size_t pos = 0);
+size_t Find(std::string_view text, std::string_view delimiter, size_t pos = 0);
+size_t FindWhitespace(std::string_view text, size_t pos = 0);	   // ' ', '\t', '\n', '\v', '\f' or '\r'
+size_t FindNotWhitespace(std::string_view text, size_t pos = 0);
+
+// Replaces tokens with the whitespace separated words of text, reusing the vector's storage
+void SplitWhitespace(std::string_view text, std::vector<std::string_view>& tokens);
+
+// Lazily splits a string into views of it, without allocating. The text must outlive the tokens.
+class Tokenizer
+{
+  public:
+	class Iterator
+	{
+	  public:
+		using value_type	  = std::string_view;
+		using difference_type = std::ptrdiff_t;
+
+		Iterator() = default;
+		Iterator(Tokenizer* tokenizer): tokenizer(tokenizer) { ++*this; }
+
+		std::string_view operator*() const { return token; }
+		Iterator&		 operator++()
+		{
+			if (!tokenizer->Next(token))
+				tokenizer = nullptr;
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+		bool operator==(std::default_sentinel_t) const { return tokenizer == nullptr; }
+
+	  private:
+		Tokenizer*		 tokenizer = nullptr;
+		std::string_view token;
+	};
+
+	// Splits on runs of whitespace; never yields empty tokens
+	explicit Tokenizer(std::string_view text): text(text), whitespace(true) {}
+	// Splits on every occurrence of delimiter, which may be several characters long. Adjacent delimiters
+	// yield empty tokens, unless collapse is set and runs of them count as one.
+	Tokenizer(std::string_view text, std::string_view delimiter, bool collapse = false):
+		text(text), delimiter(delimiter), collapse(collapse)
+	{
+	}
+
+	// Stores the next token and returns true, or returns false once the text is used up
+	bool Next(std::string_view& token);
+
+	Iterator				begin() { return Iterator(this); }
+	std::default_sentinel_t end() const { return std::default_sentinel; }
+
+  private:
+	std::string_view text;
+	std::string_view delimiter;
+	size_t			 pos		= 0;
+	bool			 whitespace = false;
+	bool			 collapse	= false;
+	bool			 finished	= false;
+};
+}	 // namespace nft::string
@@ -1,12 +1,24 @@
 #pragma once
 
+#include "vk/commands.h"
 #include "vk/common.h"
+#include "vk/memory_allocator.h"
 
 #include "extern/stb_image.h"
 
 namespace nft::vulkan
 {
 
+// Decoded RGBA8 pixels, ready for Texture::Upload
+struct TextureData
+{
+	int					 width	= 0;
+	int					 height = 0;
+	std::vector<uint8_t> pixels;
+
+	bool IsValid() const { return width > 0 && height > 0 && pixels.size() >= static_cast<size_t>(width) * height * 4; }
+};
+
 class Image
 {
   public:
@@ -39,9 +51,20 @@ class Image
 	void InitMemory(vk::MemoryPropertyFlags memory_properites);
 	void SetupCommands(vk::CommandBuffer command_buffer, vk::Queue queue);
 	void UploadPixelData(const void* pixels, size_t size, vk::ImageLayout final_layout);
-
-	void TransistionLayout(vk::ImageLayout old_layout, vk::ImageLayout new_layout);
-	void CopyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height);
+	void Cleanup();	   // Destroys the image, its view and memory so the image can be initialized again
+
+	// Both record into batch when one is given, so several operations share a submission; otherwise each is
+	// submitted and waited for on its own
+	void TransistionLayout(vk::ImageLayout old_layout, vk::ImageLayout new_layout, commands::CommandBatch* batch = nullptr);
+	// Copies rows [first_row, first_row + row_count) of the image from tightly packed rows at buffer_offset.
+	// fence is signaled by the copy's own submission, without a batch.
+	void CopyBufferToImage(vk::Buffer			   buffer,
+						   vk::DeviceSize		   buffer_offset,
+						   vk::Image			   image,
+						   uint32_t				   first_row,
+						   uint32_t				   row_count,
+						   vk::Fence			   fence = nullptr,
+						   commands::CommandBatch* batch = nullptr);
 	void CreateImageView(vk::Format format);
 	void Bind(vk::CommandBuffer		command_buffer,
 			  vk::PipelineBindPoint bind_point,
@@ -71,17 +94,18 @@ class Image
 	stbi_uc* pixels = nullptr;
 
 	// Resources
-	vk::Image				   vk_image = VK_NULL_HANDLE;
-	vk::ImageCreateInfo		   vk_image_info;
-	vk::ImageSubresourceRange  vk_subresource_range;
-	vk::ImageSubresourceLayers vk_subresource_layers;
-	vk::DeviceMemory		   vk_memory = VK_NULL_HANDLE;
-	vk::MemoryRequirements	   vk_memory_requirements;
-	vk::MemoryAllocateInfo	   vk_memory_allocate_info;
-	vk::ImageView			   vk_image_view = VK_NULL_HANDLE;
-	vk::ImageViewCreateInfo	   vk_image_view_info;
-	vk::Sampler				   vk_sampler = VK_NULL_HANDLE;
-	vk::SamplerCreateInfo	   vk_sampler_info;
+	vk::Image					vk_image = VK_NULL_HANDLE;
+	vk::ImageCreateInfo			vk_image_info;
+	vk::ImageSubresourceRange	vk_subresource_range;
+	vk::ImageSubresourceLayers	vk_subresource_layers;
+	vk::DeviceMemory			vk_memory = VK_NULL_HANDLE;	   // Shared block, see memory_allocation.offset
+	vk::MemoryRequirements		vk_memory_requirements;
+	vk::MemoryAllocateInfo		vk_memory_allocate_info;
+	MemoryAllocator::Allocation	memory_allocation;
+	vk::ImageView				vk_image_view = VK_NULL_HANDLE;
+	vk::ImageViewCreateInfo		vk_image_view_info;
+	vk::Sampler					vk_sampler = VK_NULL_HANDLE;
+	vk::SamplerCreateInfo		vk_sampler_info;
 
 	// Resource Descriptors
 	std::unique_ptr<DescriptorSetLayout> descriptor_set_layout;
@@ -110,6 +134,12 @@ class Texture: public Image
 	Texture& operator=(Texture&& other) noexcept = default;
 
 	void LoadFile(std::string file_path);
+	// Reads and decodes an image file without touching Vulkan, so it is safe to call from worker threads.
+	// Returns invalid data if the file can't be decoded.
+	static TextureData Decode(const std::string& file_path);
+	// Creates the image from decoded pixels, replacing the one the texture held. The sampler is kept, but
+	// descriptors that point at the previous image view must be rewritten, and the GPU must be done with it.
+	void Upload(const TextureData& data);
 	void CreateSampler(vk::SamplerCreateInfo sampler_info);
 	void CreateDescriptorSet(vk::DescriptorSetLayout external_layout, vk::DescriptorPool external_pool);
 	void Use(vk::CommandBuffer	   command_buffer,
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "vk/geometry.h"
+#include "vk/image.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Handle to an asset being loaded in the background. Ready once the CPU-side data is decoded; the GPU upload
+// happens later, in the on_ready callback run by AssetLoader::ProcessCompleted.
+template<typename T>
+using AssetHandle = std::shared_future<std::shared_ptr<T>>;
+
+// Pool of worker threads that read and decode assets off the render thread. Workers never touch Vulkan:
+// finished loads are queued until the render thread calls ProcessCompleted, which runs their on_ready
+// callbacks there, a few per frame.
+class AssetLoader
+{
+  public:
+	template<typename T>
+	using ReadyCallback = std::function<void(std::shared_ptr<T>)>;
+
+	// A worker_count of 0 uses one thread less than the hardware has, and at least one
+	AssetLoader(uint32_t worker_count = 0);
+	~AssetLoader();	   // Finishes the loads already running; queued ones are dropped
+
+	AssetLoader(const AssetLoader&)			   = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// Loads an OBJ mesh (or its mesh cache) through IMesh::LoadObj. The handle holds null if parsing failed.
+	AssetHandle<IMesh> LoadMesh(const std::string&			 file_dir,
+								const std::string&			 file_name,
+								const MeshOptimizer::Options& optimize_options = {},
+								ReadyCallback<IMesh>		 on_ready		  = {});
+
+	// Decodes an image file to RGBA8. The handle holds null if the file couldn't be decoded.
+	AssetHandle<TextureData> LoadTexture(const std::string& file_path, ReadyCallback<TextureData> on_ready = {});
+
+	// Runs up to max_count on_ready callbacks of finished loads on the calling thread, oldest first, and
+	// returns how many ran
+	size_t ProcessCompleted(size_t max_count = SIZE_MAX);
+
+	bool   HasCompleted() const;
+	size_t GetPendingCount() const;	   // Loads queued or running, not counting completed ones
+
+  private:
+	std::vector<std::thread>		  workers;
+	std::deque<std::function<void()>> jobs;
+	std::deque<std::function<void()>> completed;	// on_ready calls waiting for the render thread
+	mutable std::mutex				  mutex;
+	std::condition_variable			  job_available;
+	size_t							  pending  = 0;
+	bool							  stopping = false;
+
+	void WorkerLoop();
+
+	template<typename T>
+	AssetHandle<T> Submit(std::function<std::shared_ptr<T>()> load, ReadyCallback<T> on_ready);
+};
+
+}	 // namespace nft::vulkan
@@ -1,35 +1,96 @@
 #pragma once
 
 #include "vk/Common.h"
+#include "vk/commands.h"
+#include "vk/memory_allocator.h"
+
+#include <deque>
+#include <span>
 
 namespace nft::vulkan
 {
 class Device;
 
+// Buffers share device memory blocks: vk_memory is the block and memory_offset where the buffer starts in it.
+// Host-visible buffers are mapped for their whole life; use mapped rather than mapping vk_memory again.
 struct Buffer
 {
-	vk::Buffer			   vk_buffer = VK_NULL_HANDLE;
-	vk::DeviceMemory	   vk_memory = VK_NULL_HANDLE;
-	vk::BufferCreateInfo   vk_buffer_info;
-	vk::MemoryAllocateInfo vk_memory_info;
+	vk::Buffer					vk_buffer = VK_NULL_HANDLE;
+	vk::DeviceMemory			vk_memory = VK_NULL_HANDLE;
+	vk::DeviceSize				memory_offset = 0;
+	void*						mapped		  = nullptr;
+	vk::BufferCreateInfo		vk_buffer_info;
+	vk::MemoryAllocateInfo		vk_memory_info;	   // Size and type of the buffer's range
+	MemoryAllocator::Allocation allocation;
+};
+
+// Refers to a buffer owned by BufferManager. A slot is reused once its buffer is destroyed; the generation tells
+// handles to the old buffer apart from handles to the new one.
+struct BufferHandle
+{
+	static constexpr uint32_t invalid = UINT32_MAX;
+
+	uint32_t index		= invalid;
+	uint32_t generation = 0;
+
+	bool IsValid() const { return index != invalid; }
+	explicit operator bool() const { return IsValid(); }
+	bool operator==(const BufferHandle&) const = default;
 };
 
+// Owns all buffers in a slot map, so creating, destroying and looking up a buffer take constant time. Handles to
+// destroyed buffers are caught in debug builds.
 class BufferManager
 {
   public:
 	BufferManager(Device* device);
 	~BufferManager();
 
-	Buffer* CreateBuffer(size_t size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties);
-	void	DestroyBuffer(Buffer* buffer);
-	void	CopyBuffer(Buffer* src_buffer, Buffer* dst_buffer, size_t size, vk::CommandBuffer command_buffer, vk::Queue queue);
+	// shared_with_uploads makes the buffer concurrent between the graphics and transfer families, so the upload
+	// scheduler can write it without ownership transfers
+	BufferHandle CreateBuffer(size_t				  size,
+							  vk::BufferUsageFlags	  usage,
+							  vk::MemoryPropertyFlags properties,
+							  bool					  shared_with_uploads = false);
+	// The handle goes stale right away, but the buffer lives on in the device's deletion queue until frames and
+	// uploads that may use it are done, so callers need not wait for the GPU
+	void		 DestroyBuffer(BufferHandle handle);
+	// The pointer stays valid until the buffer is destroyed
+	Buffer*		 Get(BufferHandle handle);
+	bool		 IsAlive(BufferHandle handle) const;
+	// The copies record into batch when one is given, and are submitted and waited for on their own otherwise
+	void		 CopyBuffer(BufferHandle			src_buffer,
+							BufferHandle			dst_buffer,
+							size_t					size,
+							vk::CommandBuffer		command_buffer,
+							vk::Queue				queue,
+							commands::CommandBatch* batch = nullptr);
+	void		 CopyBuffer(BufferHandle					src_buffer,
+							BufferHandle					dst_buffer,
+							std::span<const vk::BufferCopy>	regions,
+							vk::CommandBuffer				command_buffer,
+							vk::Queue						queue,
+							commands::CommandBatch*			batch = nullptr);
+
+	const MemoryAllocator::Stats& GetMemoryStats() const { return allocator.GetStats(); }
 
   private:
-	Device*								 device;
-	std::vector<std::unique_ptr<Buffer>> managed_buffers;
+	struct Slot
+	{
+		Buffer	 buffer;
+		uint32_t generation = 0;
+		uint32_t next_free	= BufferHandle::invalid;
+		bool	 alive		= false;
+	};
+
+	Device*			 device;
+	MemoryAllocator	 allocator;	   // Also used by Image for its memory
+	std::deque<Slot> slots;		   // A deque keeps Buffer pointers stable as slots are added
+	uint32_t		 free_slots = BufferHandle::invalid;	// Head of the list of dead slots
 
 	uint32_t FindMemoryType(uint32_t supported_memory_indices, vk::MemoryPropertyFlags requested_properties);
+	void	 ReleaseBuffer(Buffer& buffer);
 
 	friend class Image;
 };
-}	 // namespace nft::vulkan}	 // namespace nft::vulkan
\ No newline at end of file
+}	 // namespace nft::vulkan
\ No newline at end of file
@@ -4,8 +4,48 @@
 
 #include "vk/common.h"
 
+#include <span>
+#include <vector>
+
 namespace nft::vulkan::commands
 {
 void StartJob(vk::CommandBuffer command_buffer, vk::CommandBufferUsageFlags flags);
-void EndJob(vk::CommandBuffer command_buffer, vk::Queue queue);
+
+// Collects transfers and barriers in one command buffer, submitted together and waited for on a single fence
+// instead of one submission and queue wait per operation. Barriers recorded back to back are merged into one
+// vkCmdPipelineBarrier covering the union of their stages.
+class CommandBatch
+{
+  public:
+	// Begins command_buffer; nothing reaches queue until Submit
+	CommandBatch(vk::Device device, vk::CommandBuffer command_buffer, vk::Queue queue);
+	~CommandBatch();
+
+	CommandBatch(const CommandBatch&)			 = delete;
+	CommandBatch& operator=(const CommandBatch&) = delete;
+
+	void Barrier(vk::PipelineStageFlags src_stage, vk::PipelineStageFlags dst_stage, const vk::ImageMemoryBarrier& barrier);
+	void Barrier(vk::PipelineStageFlags src_stage, vk::PipelineStageFlags dst_stage, const vk::BufferMemoryBarrier& barrier);
+	void CopyBuffer(vk::Buffer src, vk::Buffer dst, std::span<const vk::BufferCopy> regions);
+	void CopyBufferToImage(vk::Buffer src, vk::Image dst, vk::ImageLayout dst_layout, std::span<const vk::BufferImageCopy> regions);
+	// For commands the batch has no method for; barriers collected so far are recorded first
+	vk::CommandBuffer Record();
+
+	// Submits everything recorded and waits for it. fence, if given, is signaled and waited on; otherwise a
+	// temporary one is.
+	void Submit(vk::Fence fence = nullptr);
+	bool IsOpen() const { return open; }
+
+  private:
+	vk::Device							 device;
+	vk::CommandBuffer					 command_buffer;
+	vk::Queue							 queue;
+	bool								 open = true;
+	vk::PipelineStageFlags				 src_stages;	// Of the barriers not recorded yet
+	vk::PipelineStageFlags				 dst_stages;
+	std::vector<vk::ImageMemoryBarrier>	 image_barriers;
+	std::vector<vk::BufferMemoryBarrier> buffer_barriers;
+
+	void FlushBarriers();
+};
 }	 // namespace nft::vulkan::commands
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "vk/common.h"
+
+#include <deque>
+#include <functional>
+
+namespace nft::vulkan
+{
+class Device;
+
+// Holds back the destruction of Vulkan objects, and the reuse of sub-allocated ranges, until the GPU work that may
+// still use them has finished, so destroying a resource doesn't need the device to go idle first. An entry waits
+// for every frame submitted before it was pushed, and for every upload submitted by then (a timeline value of the
+// upload scheduler). Frames report their progress through SubmitFrame and RetireFrame; with nothing in flight an
+// entry is released right away.
+class DeletionQueue
+{
+  public:
+	explicit DeletionQueue(Device* device);
+	~DeletionQueue();
+
+	// destroy must not refer to the object being destroyed, only to copies of its handles. Entries giving ranges
+	// back to an owner that may be gone by then, like GeometryBatcher's, check that it still exists.
+	void Push(std::function<void()> destroy);
+
+	// Serial of a frame about to be submitted
+	uint64_t SubmitFrame() { return ++submitted_frames; }
+	// The frame with this serial, and so every frame before it, finished on the GPU
+	void	 RetireFrame(uint64_t serial);
+	// Releases everything, in the order it was pushed. Only once the device is idle.
+	void	 Flush();
+
+	size_t GetPendingCount() const { return entries.size(); }
+
+  private:
+	struct Entry
+	{
+		uint64_t			  frame;	 // Last frame submitted when the entry was pushed
+		uint64_t			  upload;	 // Last upload submitted when the entry was pushed
+		std::function<void()> destroy;
+	};
+
+	Device*			  device;
+	std::deque<Entry> entries;	  // Oldest first; both keys only grow along it
+	uint64_t		  submitted_frames = 0;
+	uint64_t		  retired_frames   = 0;
+
+	bool IsSafe(const Entry& entry) const;
+	void Collect();
+};
+
+}	 // namespace nft::vulkan
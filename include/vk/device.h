@@ -8,6 +8,9 @@ namespace nft::vulkan
 // Forward declarations
 class Instance;
 class BufferManager;
+class StagingRing;
+class UploadScheduler;
+class DeletionQueue;
 
 //=============================================================================
 // VULKAN DEVICE CLASS
@@ -22,11 +25,12 @@ class Device
 	// NESTED STRUCTURES
 	//=========================================================================
 
-	// Queue family indices for graphics and presentation
+	// Queue family indices for graphics, presentation and uploads
 	struct QueueFamilyIndices
 	{
 		std::optional<uint32_t> graphics_family;
 		std::optional<uint32_t> present_family;
+		std::optional<uint32_t> transfer_family;	// A transfer-only family if there is one, else the graphics family
 
 		// Convert to vector for Vulkan API calls
 		std::vector<uint32_t> Vec() const
@@ -72,7 +76,10 @@ class Device
 	//=========================================================================
 	// BUFFER MANAGEMENT
 	//=========================================================================
-	BufferManager* GetBufferManager() const { return buffer_manager.get(); }
+	BufferManager*	 GetBufferManager() const { return buffer_manager.get(); }
+	StagingRing*	 GetStagingRing() const { return staging_ring.get(); }
+	UploadScheduler* GetUploadScheduler() const { return upload_scheduler.get(); }
+	DeletionQueue*	 GetDeletionQueue() const { return deletion_queue.get(); }
 
 	//=========================================================================
 	// PUBLIC GETTERS (const methods for read-only access)
@@ -85,10 +92,18 @@ class Device
 	const vk::Device&		  GetDevice() const { return vk_device; }
 	const vk::Queue&		  GetGraphicsQueue() const { return vk_graphics_queue; }
 	const vk::Queue&		  GetPresentQueue() const { return vk_present_queue; }
+	const vk::Queue&		  GetTransferQueue() const { return vk_transfer_queue; }
 
 	// Device information
 	const QueueFamilyIndices&			GetQueueFamilyIndices() const { return queue_family_indices; }
 	const vk::PhysicalDeviceFeatures&	GetDeviceFeatures() const { return device_features; }
+	bool								SupportsDrawIndirectCount() const { return draw_indirect_count; }
+	bool								SupportsTimelineSemaphores() const { return timeline_semaphores; }
+	bool								SupportsPresentFences() const { return present_fences; }
+	bool								HasDedicatedTransferQueue() const
+	{
+		return queue_family_indices.transfer_family != queue_family_indices.graphics_family;
+	}
 	const vk::PhysicalDeviceProperties& GetDeviceProperties() const { return device_properties; }
 	const std::vector<const char*>&		GetExtensions() const { return extensions; }
 	const std::vector<const char*>&		GetLayers() const { return layers; }
@@ -107,9 +122,13 @@ class Device
 	vk::Device		   vk_device;
 	vk::Queue		   vk_graphics_queue = nullptr;
 	vk::Queue		   vk_present_queue	 = nullptr;
+	vk::Queue		   vk_transfer_queue = nullptr;	   // The graphics queue without a dedicated transfer family
 
 	// Resource managers
-	std::unique_ptr<BufferManager> buffer_manager;
+	std::unique_ptr<BufferManager>	 buffer_manager;
+	std::unique_ptr<StagingRing>	 staging_ring;	  // Shared by all uploads; lives in a buffer_manager buffer
+	std::unique_ptr<UploadScheduler> upload_scheduler;
+	std::unique_ptr<DeletionQueue>	 deletion_queue;	// Destroyed resources wait here until the GPU is done with them
 
 	// Device selection data
 	std::vector<vk::PhysicalDevice> available_devices;
@@ -120,8 +139,13 @@ class Device
 	std::vector<const char*>		layers;
 
 	// Device creation data
-	vk::DeviceCreateInfo				   vk_device_info;
-	std::vector<vk::DeviceQueueCreateInfo> vk_device_queue_info;
+	vk::DeviceCreateInfo								vk_device_info;
+	std::vector<vk::DeviceQueueCreateInfo>				vk_device_queue_info;
+	vk::PhysicalDeviceVulkan12Features					vulkan12_features;				   // Chained to the device info when used
+	vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT	swapchain_maintenance_features;	   // Likewise
+	bool												draw_indirect_count = false;
+	bool												timeline_semaphores = false;
+	bool												present_fences      = false;
 
 	//=========================================================================
 	// PRIVATE HELPER METHODS
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Gribb/Hartmann extraction for a [0, 1] depth range: left, right, bottom, top, near, far, in the space view_proj
+// maps from, normalized and pointing inwards
+void ExtractFrustumPlanes(const glm::mat4& view_proj, glm::vec4 planes[6]);
+
+// CPU frustum culling of whole objects by bounding sphere. Added spheres and transforms are kept as one array per
+// component, so Cull moves 8 (AVX) or 4 (SSE) spheres to world space and tests them against a plane with each
+// instruction.
+class FrustumCuller
+{
+  public:
+	struct Stats
+	{
+		uint32_t visible = 0;
+		uint32_t culled	 = 0;
+	};
+
+	void SetView(const glm::mat4& view_proj) { ExtractFrustumPlanes(view_proj, frustum_planes); }
+
+	// Starts a new set of objects
+	void Clear();
+	// Adds an object by its model-space bounding sphere (center, radius) and transform; the largest axis scale
+	// keeps the world-space sphere conservative
+	void Add(const glm::vec4& sphere, const glm::mat4& transform);
+	// Replaces visible with a flag per added object, in order: 1 if its sphere touches the frustum
+	void Cull(std::vector<uint8_t>& visible);
+
+	const Stats& GetStats() const { return stats; }	   // Of the last Cull
+
+  private:
+	// Components of the added objects: the model-space sphere, then the upper three rows of the transform by column
+	enum Component
+	{
+		SphereX,
+		SphereY,
+		SphereZ,
+		SphereRadius,
+		Transform,
+		ComponentCount = Transform + 12
+	};
+
+	glm::vec4									   frustum_planes[6];
+	std::array<std::vector<float>, ComponentCount> components;	// Padded to a whole SIMD block by Cull
+	size_t										   count = 0;
+	Stats										   stats;
+};
+
+}	 // namespace nft::vulkan
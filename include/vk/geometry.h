@@ -1,7 +1,16 @@
 #pragma once
 
+#include "vk/buffer.h"
 #include "vk/common.h"
+#include "vk/mesh_cache.h"
+#include "vk/mesh_optimizer.h"
+#include "vk/mesh_simplifier.h"
+#include "vk/meshlet.h"
+#include "vk/range_allocator.h"
+#include "vk/vertex_format.h"
 #include <map>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace nft::vulkan
@@ -18,8 +27,8 @@ struct Material
 	uint32_t  specular_texture_index = UINT32_MAX;	  // Index into texture array (UINT32_MAX = no texture)
 };
 
-// Push constant structure for per-object material data (must be <= 128 bytes)
-struct MaterialPushConstants
+// Material as stored in the material storage buffer (std430 layout), indexed per instance by the shaders
+struct PackedMaterial
 {
 	alignas(16) glm::vec3 ambient;
 	alignas(16) glm::vec3 diffuse;
@@ -51,11 +60,31 @@ class IMesh
 	}
 	~IMesh()									   = default;
 	virtual void AddVertex(VertexData vertex_data) = 0;
-	void		 LoadObj(const std::string& file_dir, const std::string& file_name);	// Load mesh from OBJ file
+	// Load mesh from OBJ file, or its .nftmesh cache. Freshly parsed meshes are run through the MeshOptimizer
+	// stages enabled in optimize_options (none by default, which keeps the file's vertex and triangle order),
+	// split into meshlets and given a LOD chain before they are cached.
+	void LoadObj(const std::string& file_dir, const std::string& file_name, const MeshOptimizer::Options& optimize_options = {});
+
+	// Vertex and index data, either owned by the mesh or pointing into a mapped mesh cache. The index data holds
+	// every level of detail back to back, LOD 0 first.
+	std::span<const float>	  GetVertexData() const;
+	std::span<const uint32_t> GetIndexData() const;
+
+	const Bounds&					  GetBounds() const { return bounds; }
+	const std::vector<MaterialRange>& GetMaterialRanges() const { return material_ranges; }
+	std::span<const Meshlet>		  GetMeshlets() const;	  // Cover LOD 0 only
+	std::span<const MeshLod>		  GetLods() const;		  // Empty if the mesh has no LOD chain
 
   protected:
 	std::unique_ptr<std::vector<float>>	   vertices;
 	std::unique_ptr<std::vector<uint32_t>> indices;	   // Optional indices for indexed drawing
+	std::shared_ptr<const MeshCache>	   cache;	   // Set when the data comes from a mapped .nftmesh file
+	Bounds								   bounds;
+	std::vector<MaterialRange>			   material_ranges;
+	std::vector<Meshlet>				   meshlets;	// Empty when loaded from a cache, which holds them instead
+	std::vector<MeshLod>				   lods;		// Likewise held by the cache when there is one
+
+	void DetachCache();	   // Copies the cached full mesh into the owned vectors so it can be modified; drops meshlets and LODs
 
 	friend class GeometryBatcher;
 	friend class Surface;
@@ -81,31 +110,102 @@ class SimpleMesh: public IMesh
 class GeometryBatcher
 {
   public:
+	struct LodRange
+	{
+		uint32_t first_index;	 // In the index buffer, in elements of the mesh's index type
+		uint32_t index_count;
+		float	 error;			 // Model-space error relative to LOD 0
+	};
+
 	struct MeshData
 	{
-		size_t offset;				// Offset in the vertex_data vector
-		size_t size;				// Number of vertices in the mesh
-		size_t index_offset = 0;	// Offset in the index_data vector (if indices are used)
-		size_t index_size	= 0;	// Number of indices in the mesh (if indices are used)
+		size_t				  offset;								 // Offset in the vertex buffer, in vertices
+		size_t				  size;									 // Number of vertices in the mesh
+		size_t				  index_offset = 0;						 // First index in the index buffer, in elements of index_type
+		size_t				  index_size   = 0;						 // Number of indices of all levels (if indices are used)
+		vk::IndexType		  index_type   = vk::IndexType::eUint32;	 // 16-bit for meshes with fewer than 65536 vertices
+		uint32_t			  id           = 0;						 // Small number for render queue sort keys
+		Bounds				  bounds;								 // Quantization range for compact vertices, and LOD selection
+		glm::vec4			  sphere;								 // Bounding sphere (center, radius) for frustum culling
+		std::vector<LodRange> lods;									 // At least one level if indices are used
+
+		size_t GetIndexStride() const { return index_type == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+	};
+
+	struct FragmentationStats
+	{
+		RangeAllocator::Stats vertices;	   // In vertices
+		RangeAllocator::Stats indices;	   // In bytes
 	};
 
-	GeometryBatcher(Device* device);
+	static constexpr size_t initial_vertex_capacity = 1 << 16;	  // In vertices
+	static constexpr size_t initial_index_capacity	= 1 << 20;	  // In bytes
+
+	GeometryBatcher(Device* device, VertexFormat vertex_format = VertexFormat::Compact);
 	~GeometryBatcher() = default;
 
-	void	AddGeometry(const IMesh* mesh);
-	void	CreateBuffers(vk::CommandBuffer command_buffer, vk::Queue queue);
-	Buffer* GetVertexBuffer() const { return vertex_buffer; }
+	// Meshes live in sub-allocated ranges of two device-local buffers that grow as needed. Adding, updating or
+	// removing a mesh only changes its own range; Upload sends the pending ones to the GPU.
+	void		 AddGeometry(const IMesh* mesh);
+	void		 UpdateGeometry(const IMesh* mesh);	   // The mesh's data changed; it moves to ranges no frame in flight reads
+	void		 RemoveGeometry(const IMesh* mesh);
+	bool		 HasGeometry(const IMesh* mesh) const { return mesh_data.contains(mesh); }
+
+	// Uploads the meshes added or updated since the last call. Ranges of removed meshes are only reused once the
+	// frames and uploads that may read them have retired, so new data never lands under a draw in flight. Growing
+	// replaces the buffers, so the GPU must be done with earlier draws; it copies on queue and waits for it. The mesh
+	// data itself goes through the upload scheduler without waiting.
+	void		 Upload(vk::CommandBuffer command_buffer, vk::Queue queue);
+
+	// Moves up to byte_budget bytes of mesh data (always at least one range) down into lower free ranges, and
+	// returns whether anything is left to move. The copies are recorded into command_buffer, a frame's commands
+	// outside a render pass, ahead of its draws; the offsets change right away, so those draws and later ones use
+	// the new ranges. Frames already in flight keep reading the old ones, which are only freed once they finish.
+	// When a pass finds nothing it can move, passes do nothing until either allocator changes.
+	bool			   Compact(size_t byte_budget, vk::CommandBuffer command_buffer);
+	FragmentationStats GetFragmentationStats() const { return { vertex_allocator.GetStats(), index_allocator.GetStats() }; }
+
+	BufferHandle GetVertexBuffer() const { return vertex_buffer; }
+	VertexFormat GetVertexFormat() const { return vertex_format; }
+
+	// Transform from the mesh's stored vertex positions to model space, applied before the object transform
+	glm::mat4 GetMeshTransform(const IMesh* mesh) const;
+	// Box around the mesh's stored vertex positions, in the space GetMeshTransform maps from
+	Bounds	  GetVertexBounds(const MeshData& data) const;
+
+	// Coarsest level whose error, projected at the object's distance, stays within max_pixel_error.
+	// pixel_scale turns a size at view distance 1 into pixels (proj[1][1] * viewport height / 2).
+	static size_t SelectLod(const MeshData&	 data,
+							const glm::mat4& transform,
+							const glm::vec3& camera_position,
+							float			 pixel_scale,
+							float			 max_pixel_error);
 
   private:
 	Device*							 device;	// Device used for Vulkan operations
+	VertexFormat					 vertex_format;
 	std::map<const IMesh*, MeshData> mesh_data;
-	std::vector<float>				 vertex_data;
-	std::vector<uint32_t>			 index_data;			// Optional indices for indexed drawing
-	size_t							 current_offset = 0;	// Current offset in the vertex_data vector
-	size_t							 index_offset	= 0;	// Current offset in the indices_data vector
+	RangeAllocator					 vertex_allocator;	  // In vertices
+	RangeAllocator					 index_allocator;	  // In bytes, as meshes differ in index type
+	std::vector<const IMesh*>		 pending_uploads;
+	uint32_t						 next_mesh_id = 0;
+
+	// Change counts of the allocators when compaction last found nothing to move
+	std::pair<size_t, size_t> compaction_stalled_at = { RangeAllocator::invalid, RangeAllocator::invalid };
+
+	BufferHandle vertex_buffer;
+	BufferHandle index_buffer;	  // Invalid until a mesh with indices is uploaded
+
+	// Frees left in the deletion queue check it, so they do nothing once the batcher is gone
+	std::shared_ptr<bool> lifetime = std::make_shared<bool>(true);
+
+	// Gives ranges back to the allocators through the deletion queue, once the frames and uploads submitted so far
+	// are done with them. Either range may be empty.
+	void FreeRanges(size_t vertex_offset, size_t vertex_count, size_t index_offset, size_t index_bytes);
 
-	Buffer* vertex_buffer;
-	Buffer* index_buffer;
+	// Replaces buffer by one of at least size bytes, copying the data over in batch. Returns the old buffer, to be
+	// destroyed once batch is submitted; invalid if buffer was big enough.
+	BufferHandle GrowBuffer(BufferHandle& buffer, size_t size, vk::BufferUsageFlags usage, commands::CommandBatch& batch);
 
 	friend class Scene;
 	friend class Surface;
@@ -60,6 +60,8 @@ public:
     // Extension and layer information
     const std::vector<const char*>& GetExtensions() const { return extensions; }
     const std::vector<const char*>& GetLayers() const { return layers; }
+    // Whether the surface maintenance extensions are enabled, which swapchain maintenance builds on
+    bool SupportsSurfaceMaintenance() const { return surface_maintenance; }
 
 private:
     //=========================================================================
@@ -82,6 +84,7 @@ private:
     vk::ApplicationInfo                  vk_app_info = nullptr;
     std::vector<const char*>             extensions;
     std::vector<const char*>             layers;
+    bool                                 surface_maintenance = false;
     vk::InstanceCreateInfo               vk_instance_info;
     vk::DebugUtilsMessengerCreateInfoEXT vk_debug_messenger_info;
 
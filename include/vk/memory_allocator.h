@@ -0,0 +1,72 @@
+#pragma once
+
+#include "vk/common.h"
+#include "vk/tlsf_allocator.h"
+
+#include <memory>
+#include <vector>
+
+namespace nft::vulkan
+{
+class Device;
+
+// Hands out device memory from large blocks instead of one vkAllocateMemory per resource. Each memory type has
+// two sets of blocks: one for buffers and linear images, one for optimal-tiling images. Keeping them apart means
+// bufferImageGranularity never applies between neighbours. Within a block, ranges come from a TlsfAllocator.
+// Host-visible blocks are mapped once when created and stay mapped; allocations carry their pointer.
+class MemoryAllocator
+{
+  private:
+	struct Block;
+
+  public:
+	struct Allocation
+	{
+		vk::DeviceMemory memory = VK_NULL_HANDLE;
+		vk::DeviceSize	 offset = 0;
+		vk::DeviceSize	 size	= 0;
+		void*			 mapped = nullptr;	  // At offset, if the memory is host visible
+
+		Block*	 block = nullptr;	 // Null for dedicated allocations
+		uint32_t node  = TlsfAllocator::invalid;
+	};
+
+	struct Stats
+	{
+		uint32_t	   device_allocations = 0;	  // Live vkAllocateMemory allocations: blocks and dedicated ones
+		uint32_t	   allocations		  = 0;	  // Live allocations handed out
+		vk::DeviceSize reserved			  = 0;	  // Bytes allocated from the device
+		vk::DeviceSize used				  = 0;	  // Bytes handed out
+	};
+
+	// Requests larger than half a block get a dedicated allocation
+	MemoryAllocator(Device* device, vk::DeviceSize block_size = vk::DeviceSize(64) << 20);
+	~MemoryAllocator();
+
+	Allocation Allocate(const vk::MemoryRequirements& requirements, uint32_t memory_type_index, bool linear);
+	// Returns the range to its block; a block left empty is released unless it is the last of its set
+	void	   Free(Allocation& allocation);
+
+	const Stats& GetStats() const { return stats; }
+
+  private:
+	struct Block
+	{
+		vk::DeviceMemory memory;
+		void*			 mapped;
+		TlsfAllocator	 ranges;
+		uint32_t		 pool;	  // Index into pools
+	};
+
+	Device*							 device;
+	vk::DeviceSize					 block_size;
+	vk::PhysicalDeviceMemoryProperties memory_properties;
+	// memory type * 2 + linear
+	std::vector<std::vector<std::unique_ptr<Block>>> pools;
+	Stats											 stats;
+
+	vk::DeviceMemory AllocateDeviceMemory(vk::DeviceSize size, uint32_t memory_type_index, void*& mapped);
+	void			 FreeDeviceMemory(vk::DeviceMemory memory, vk::DeviceSize size);
+};
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "core/mapped_file.h"
+#include "core/parse_obj.h"
+
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace nft::vulkan
+{
+
+using MaterialRange = parse::ObjLoader::MaterialRange;
+
+struct Bounds
+{
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+};
+
+// Small cluster of triangles that is culled as a unit; built by MeshletBuilder
+struct Meshlet
+{
+	glm::vec3 center;		   // Bounding sphere in model space
+	float	  radius;
+	glm::vec3 cone_axis;	   // Every triangle normal lies within the cone around this axis
+	float	  cone_cutoff;	   // Sine of the cone's spread, > 1 if the cluster can never be back-facing
+	uint32_t  first_index;	   // Mesh-local range in the index buffer
+	uint32_t  index_count;
+	uint32_t  vertex_count;	   // Unique vertices referenced by the range
+};
+
+// One level of detail: a mesh-local index range into the shared vertex data; built by MeshSimplifier
+struct MeshLod
+{
+	uint32_t first_index;
+	uint32_t index_count;
+	float	 error;	   // Largest model-space deviation from LOD 0
+};
+
+// Versioned binary container for a parsed mesh (.nftmesh), stored next to its source file.
+// A loaded cache is memory-mapped and hands out spans that point straight into the mapping.
+class MeshCache
+{
+  public:
+	static constexpr char	  magic[8]		= { 'N', 'F', 'T', 'M', 'E', 'S', 'H', '\0' };
+	static constexpr uint32_t version		= 5;
+	static constexpr uint32_t vertex_stride = 12;	 // Floats per interleaved vertex (pos3, color4, uv2, normal3)
+
+	struct Header
+	{
+		char	 magic[8];
+		uint32_t version;
+		uint32_t flags;	   // Processing applied to the mesh (MeshOptimizer::Options::GetFlags()); part of the cache key
+
+		// Cache key: the cache is only valid for the exact source file it was built from, and the dependencies
+		uint64_t source_size;
+		int64_t	 source_mtime;
+		uint64_t source_hash;
+
+		uint32_t vertex_stride;
+		uint32_t path_size;
+		uint64_t path_offset;
+		uint64_t vertex_count;
+		uint64_t vertex_offset;
+		uint64_t index_count;
+		uint64_t index_offset;
+		uint64_t material_range_count;
+		uint64_t material_range_offset;
+		uint64_t meshlet_count;
+		uint64_t meshlet_offset;
+		uint64_t lod_count;
+		uint64_t lod_offset;
+		uint64_t dependency_count;
+		uint64_t dependency_offset;
+
+		float bounds_min[3];
+		float bounds_max[3];
+	};
+
+	// Other file the mesh was built from, such as an MTL library; part of the cache key like the source file
+	struct Dependency
+	{
+		uint64_t size;
+		int64_t	 mtime;
+		uint64_t hash;
+		uint64_t path_offset;	 // In the cache file
+		uint64_t path_size;
+	};
+
+	// Returns the mapped cache for source_path, or nullptr if there is none, it is stale or was built with other
+	// flags. Files are only hashed when their size matches but their modification time doesn't.
+	static std::shared_ptr<const MeshCache> Load(const std::string& source_path, uint32_t flags);
+	static bool								Write(const std::string&			 source_path,
+												  uint32_t						 flags,
+												  std::span<const std::string>	 dependencies,
+												  std::span<const float>		 vertices,
+												  std::span<const uint32_t>		 indices,
+												  std::span<const MaterialRange> material_ranges,
+												  std::span<const Meshlet>		 meshlets,
+												  std::span<const MeshLod>		 lods,
+												  const Bounds&					 bounds);
+	static std::string						GetCachePath(const std::string& source_path);
+
+	std::span<const float>		   GetVertices() const;
+	std::span<const uint32_t>	   GetIndices() const;
+	std::span<const MaterialRange> GetMaterialRanges() const;
+	std::span<const Meshlet>	   GetMeshlets() const;
+	std::span<const MeshLod>	   GetLods() const;
+	Bounds						   GetBounds() const;
+
+  private:
+	struct SourceInfo
+	{
+		uint64_t size  = 0;
+		int64_t	 mtime = 0;
+		uint64_t hash  = 0;
+	};
+
+	MappedFile	  file;
+	const Header* header = nullptr;
+
+	static bool GetSourceInfo(const std::string& source_path, SourceInfo& info, bool hash_contents);
+	// Whether the file still has the recorded size and contents
+	static bool IsUnchanged(const std::string& path, uint64_t size, int64_t mtime, uint64_t hash);
+
+	template<typename T>
+	std::span<const T> GetSection(uint64_t offset, uint64_t count) const
+	{
+		return std::span<const T>(reinterpret_cast<const T*>(file.GetData() + offset), count);
+	}
+};
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "vk/mesh_cache.h"
+
+#include <span>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Post-load reordering of indexed triangle meshes for the GPU. Triangles are only reordered within their
+// material range, so MaterialRange offsets stay valid. Every stage changes the order of the loaded data, so they
+// are off unless asked for.
+class MeshOptimizer
+{
+  public:
+	struct Options
+	{
+		bool	 vertex_cache		= false;	// Forsyth-style triangle reordering for post-transform cache hits
+		bool	 overdraw			= false;	// Sort cache-coherent clusters front-to-back from the mesh center
+		bool	 vertex_fetch		= false;	// Renumber vertices in order of first use
+		float	 overdraw_threshold = 1.05f;	// Keep the overdraw sort only if ACMR grows by at most this factor
+		uint32_t cache_size			= 16;		// FIFO size used to measure ACMR
+		uint32_t lod_levels			= 4;		// Levels of detail built by MeshSimplifier, including the full mesh
+
+		bool	 IsEnabled() const { return vertex_cache || overdraw || vertex_fetch; }
+		uint32_t GetFlags() const
+		{
+			return (vertex_cache ? 1u : 0u) | (overdraw ? 2u : 0u) | (vertex_fetch ? 4u : 0u) | (lod_levels << 8);
+		}
+	};
+
+	struct Report
+	{
+		float acmr_before = 0.0f;	 // Average cache miss ratio: transformed vertices per triangle
+		float acmr_after  = 0.0f;
+	};
+
+	MeshOptimizer()	 = delete;
+	~MeshOptimizer() = delete;
+
+	// Runs the enabled stages on interleaved vertices (MeshCache::vertex_stride floats each) and their indices
+	static Report Optimize(std::vector<float>&				  vertices,
+						   std::vector<uint32_t>&			  indices,
+						   const std::vector<MaterialRange>& material_ranges,
+						   const Options&					  options);
+
+	static float ComputeACMR(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size);
+
+	static void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertex_count);
+	static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const float> vertices, size_t vertex_count, uint32_t cache_size);
+	static void OptimizeVertexFetch(std::vector<float>& vertices, std::span<uint32_t> indices);
+};
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "vk/mesh_cache.h"
+
+#include <span>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Quadric-error edge collapse (Garland/Heckbert) that only moves vertices onto existing ones, so every
+// level of detail indexes the same vertex buffer. Collapses work on positions, so vertices split by normals
+// or texture seams move together; mesh borders are never collapsed.
+class MeshSimplifier
+{
+  public:
+	static constexpr float	  level_reduction	 = 0.5f;	 // Target triangle count of each level relative to the previous
+	static constexpr uint32_t min_triangles		 = 64;		 // Don't build levels below this size
+	static constexpr float	  max_relative_error = 0.05f;	 // Largest error allowed, relative to the bounds diagonal
+
+	MeshSimplifier()  = delete;
+	~MeshSimplifier() = delete;
+
+	// Appends up to level_count - 1 simplified index sets to indices and returns every level, LOD 0 being
+	// the original indices. Errors are model-space distances.
+	static std::vector<MeshLod> BuildLodChain(std::span<const float> vertices, std::vector<uint32_t>& indices, uint32_t level_count);
+
+	// Collapses edges until at most target_index_count indices are left or the error would exceed max_error
+	static std::vector<uint32_t> Simplify(std::span<const float>	vertices,
+										  std::span<const uint32_t> indices,
+										  size_t					target_index_count,
+										  float						max_error,
+										  float&					result_error);
+};
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "vk/mesh_cache.h"
+
+#include <span>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Splits an indexed mesh into meshlets. Triangles are taken in index buffer order, so every meshlet is a
+// contiguous index range; run MeshOptimizer first to keep clusters spatially tight.
+class MeshletBuilder
+{
+  public:
+	static constexpr uint32_t max_vertices	= 64;
+	static constexpr uint32_t max_triangles = 124;
+
+	MeshletBuilder()  = delete;
+	~MeshletBuilder() = delete;
+
+	// Meshlets never cross a material range, so ranges can still be drawn separately
+	static std::vector<Meshlet> Build(std::span<const float>		 vertices,
+									  std::span<const uint32_t>		 indices,
+									  std::span<const MaterialRange> material_ranges);
+};
+
+// CPU cluster culling against the view frustum and the meshlets' normal cones. The cone test assumes
+// one-sided geometry (closed meshes, or back faces that are never meant to be seen).
+class MeshletCuller
+{
+  public:
+	struct Options
+	{
+		bool	 frustum	  = true;
+		bool	 cone		  = true;
+		uint32_t min_meshlets = 4;	  // Meshes with fewer meshlets are drawn whole
+	};
+
+	struct Stats
+	{
+		uint32_t meshlets		= 0;
+		uint32_t frustum_culled = 0;
+		uint32_t cone_culled	= 0;
+	};
+
+	struct IndexRange
+	{
+		uint32_t first_index;	 // Mesh-local
+		uint32_t index_count;
+	};
+
+	MeshletCuller() = default;
+	MeshletCuller(const Options& options): options(options) {}
+
+	void SetView(const glm::mat4& view_proj, const glm::vec3& camera_position);
+
+	// Replaces ranges with the index ranges of the visible meshlets, merging neighbours that stay contiguous
+	void Cull(std::span<const Meshlet> meshlets, const glm::mat4& transform, std::vector<IndexRange>& ranges);
+
+	const Stats&	 GetStats() const { return stats; }
+	void			 ResetStats() { stats = Stats(); }
+	const glm::vec4* GetFrustumPlanes() const { return frustum_planes; }	// The six planes of the last SetView
+
+  private:
+	Options	  options;
+	Stats	  stats;
+	glm::vec4 frustum_planes[6];	// World space, normalized, pointing inwards
+	glm::vec3 camera_position = glm::vec3(0.0f);
+};
+
+}	 // namespace nft::vulkan
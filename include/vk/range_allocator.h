@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+namespace nft::vulkan
+{
+
+// Offset allocator for sub-allocating ranges of a buffer; it only does the bookkeeping, in whatever unit the
+// caller uses. Free ranges are merged with their neighbours when released, and allocations take the smallest
+// free range that fits.
+class RangeAllocator
+{
+  public:
+	static constexpr size_t invalid = SIZE_MAX;
+
+	struct Stats
+	{
+		size_t capacity		= 0;
+		size_t used			= 0;
+		size_t free_ranges	= 0;
+		size_t largest_free = 0;
+
+		// Share of the free space outside the largest free range: 0 when it is all in one piece, close to 1
+		// when it is scattered into many small holes
+		float GetFragmentation() const
+		{
+			size_t free = capacity - used;
+			return free == 0 ? 0.0f : 1.0f - static_cast<float>(largest_free) / static_cast<float>(free);
+		}
+	};
+
+	RangeAllocator(size_t capacity = 0);
+
+	// Offset of a new range, or invalid if no free range fits (Grow and try again)
+	size_t Allocate(size_t size, size_t alignment = 1);
+	// Lowest free range that fits entirely below limit, or invalid; used to move ranges towards the start
+	size_t AllocateBelow(size_t size, size_t alignment, size_t limit);
+	void   Free(size_t offset, size_t size);
+	// Appends free space at the end; existing ranges keep their offsets
+	void   Grow(size_t new_capacity);
+
+	size_t GetCapacity() const { return capacity; }
+	size_t GetUsed() const { return used; }
+	size_t GetLargestFree() const { return free_by_size.empty() ? 0 : free_by_size.rbegin()->first; }
+	size_t GetFreeRangeCount() const { return free_ranges.size(); }
+	Stats  GetStats() const { return { capacity, used, free_ranges.size(), GetLargestFree() }; }
+	// Counts allocations, frees and growth; equal counts mean nothing was taken or given back in between
+	size_t GetChangeCount() const { return change_count; }
+
+  private:
+	size_t							   capacity		= 0;
+	size_t							   used			= 0;
+	size_t							   change_count	= 0;
+	std::map<size_t, size_t>		   free_ranges;	   // Offset -> size
+	std::set<std::pair<size_t, size_t>> free_by_size;	   // (size, offset), for best fit
+
+	void AddFree(size_t offset, size_t size);
+	void Take(std::map<size_t, size_t>::iterator range, size_t offset, size_t size);	 // Splits off an aligned range
+	void RemoveFree(std::map<size_t, size_t>::iterator range);
+};
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Draws of a frame, ordered by 64-bit sort keys. The state a draw binds sits in the high bits so equal state ends
+// up adjacent; view depth below it orders each run front to back for early depth rejection. Keys are radix
+// sorted, which is linear in the number of draws and stable, so equal keys keep the order they were pushed in.
+class RenderQueue
+{
+  public:
+	// Key layout, most significant first
+	static constexpr uint32_t pipeline_bits	  = 3;
+	static constexpr uint32_t index_type_bits = 1;
+	static constexpr uint32_t mesh_bits		  = 20;
+	static constexpr uint32_t level_bits	  = 6;
+	static constexpr uint32_t material_bits	  = 10;
+	static constexpr uint32_t depth_bits	  = 24;
+	static_assert(pipeline_bits + index_type_bits + mesh_bits + level_bits + material_bits + depth_bits == 64);
+
+	// Keys that agree above this shift draw with the same pipeline, index buffer, mesh, level of detail and material
+	static constexpr uint32_t batch_shift = depth_bits;
+
+	// State that is bound between draws, for redundant bind tracking
+	enum class State : uint32_t
+	{
+		Pipeline,
+		IndexBuffer,
+		Count
+	};
+
+	struct Entry
+	{
+		uint64_t key;
+		uint32_t value;	   // Caller's payload, e.g. an object index
+	};
+
+	struct Stats
+	{
+		uint32_t draws		   = 0;	   // Entries sorted this frame
+		uint32_t binds		   = 0;	   // State changes recorded
+		uint32_t binds_skipped = 0;	   // Binds left out because the state was already bound
+	};
+
+	// depth is the distance along the view direction; anything behind the camera sorts first. Material sits above
+	// it: an instanced draw indexes the texture array by its material, which has to be the same for all instances.
+	static uint64_t MakeKey(uint32_t pipeline, uint32_t index_type, uint32_t mesh, uint32_t level, float depth, uint32_t material);
+
+	// Starts a new frame: drops the entries, resets the counters and forgets the bound state
+	void Clear();
+	void Push(uint64_t key, uint32_t value) { entries.push_back({ key, value }); }
+	void Sort();
+
+	std::span<const Entry> GetEntries() const { return entries; }
+
+	// Returns whether value must be bound for the next draw, i.e. differs from what is bound, and counts it
+	bool NeedsBind(State state, uint32_t value);
+
+	const Stats& GetStats() const { return stats; }
+
+  private:
+	std::vector<Entry> entries;
+	std::vector<Entry> scratch;	   // Other half of the ping-pong buffers of the sort
+	std::array<uint32_t, static_cast<size_t>(State::Count)> bound_state;
+	std::array<bool, static_cast<size_t>(State::Count)>		state_bound {};
+	Stats													stats;
+};
+
+}	 // namespace nft::vulkan
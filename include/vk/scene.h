@@ -2,6 +2,7 @@
 
 #include "core/event.h"
 
+#include "vk/asset_loader.h"
 #include "vk/common.h"
 #include "vk/geometry.h"
 #include "vk/image.h"
@@ -80,13 +81,34 @@ class Scene: Observer
 	const std::vector<ObjectData>& GetObjects() const { return objects; }
 
 	// Add a material to the scene
-	void AddMaterial(const Material& material) { materials.push_back(material); }
+	void AddMaterial(const Material& material)
+	{
+		materials.push_back(material);
+		materials_version++;
+	}
+	// Replace a material; objects using it pick up the change on the next frame
+	void SetMaterial(uint32_t index, const Material& material)
+	{
+		materials.at(index) = material;
+		materials_version++;
+	}
 	// Get all materials in the scene
 	const std::vector<Material>& GetMaterials() const { return materials; }
+	// Changes whenever the materials do, so renderers only upload them again then
+	uint32_t					 GetMaterialsVersion() const { return materials_version; }
 
 	// Get the geometry batcher
 	const GeometryBatcher* GetGeometryBatcher() { return geometry_batcher.get(); }
 
+	// Assets stream in on the loader's worker threads; objects show placeholders until theirs arrive
+	AssetLoader* GetAssetLoader() { return asset_loader.get(); }
+	bool		 HasLoadedAssets() const { return asset_loader->HasCompleted(); }
+	// Uploads up to max_count finished assets and swaps them in. Meshes take new ranges and buffers while frames in
+	// flight keep the old ones; textures replace their images, so those wait for the device to go idle first.
+	size_t		 ProcessLoadedAssets(size_t max_count = 1);
+	// Changes whenever a texture's image is replaced, so renderers only rewrite their descriptors then
+	uint32_t	 GetTexturesVersion() const { return textures_version; }
+
   private:
 	Surface* surface;
 	Device*	 device;	// Vulkan device
@@ -108,15 +130,26 @@ class Scene: Observer
 	// Helper function to update camera transform from orbital parameters
 	void UpdateCameraFromOrbit();
 
+	// Replaces the placeholder mesh of an object with one loaded in the background
+	void StreamMesh(size_t object_index, const std::string& file_dir, const std::string& file_name);
+	// Replaces the placeholder image of a texture with one decoded in the background
+	void StreamTexture(size_t texture_index, const std::string& file_path);
+
 	std::vector<ObjectData>			 objects;			  // List of objects in the scene
 	std::unique_ptr<GeometryBatcher> geometry_batcher;	  // Geometry batcher for efficient rendering
 	std::vector<IMesh*>				 meshes;
 	std::vector<Texture>			 textures;
+	uint32_t						 textures_version = 1;
 	std::vector<Material>			 materials;	   // List of materials in the scene
+	uint32_t						 materials_version = 1;
+
+	std::unique_ptr<AssetLoader>		asset_loader;
+	std::vector<std::shared_ptr<IMesh>> streamed_meshes;		 // Owns the meshes handed over by the loader
+	vk::CommandBuffer					upload_command_buffer;	 // Used for uploads of streamed assets
 
 	friend class Surface;
 };
-vk::VertexInputBindingDescription				 GetVertexInputBindingDescription();
-std::vector<vk::VertexInputAttributeDescription> GetVertexInputAttributeDescriptions();
+vk::VertexInputBindingDescription				 GetVertexInputBindingDescription(VertexFormat format = VertexFormat::Full);
+std::vector<vk::VertexInputAttributeDescription> GetVertexInputAttributeDescriptions(VertexFormat format = VertexFormat::Full);
 
 }	 // namespace nft::vulkan
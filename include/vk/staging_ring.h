@@ -0,0 +1,59 @@
+#pragma once
+
+#include "vk/buffer.h"
+#include "vk/common.h"
+
+#include <deque>
+#include <vector>
+
+namespace nft::vulkan
+{
+class Device;
+
+// One persistently mapped host-visible buffer that every upload stages its data in. Ranges are handed out
+// linearly and wrap around at the end. Ranges allocated between two EndBatch calls form a batch, given back
+// once the fence of the submission that read them has signaled.
+class StagingRing
+{
+  public:
+	struct Range
+	{
+		vk::DeviceSize offset = 0;	  // In GetBuffer()
+		vk::DeviceSize size	  = 0;	  // 0 if the request failed
+		char*		   data	  = nullptr;
+	};
+
+	StagingRing(Device* device, vk::DeviceSize capacity = vk::DeviceSize(32) << 20);
+	~StagingRing();
+
+	// size bytes, at most GetCapacity(). Waits for submitted batches when the ring is full; fails only when the
+	// space is held by the open batch, which then has to be submitted before trying again.
+	Range Allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+	// Closes the open batch. The submission reading its ranges must signal the returned fence.
+	vk::Fence EndBatch();
+
+	vk::Buffer	   GetBuffer() const { return vk_buffer; }
+	vk::DeviceSize GetCapacity() const { return capacity; }
+
+  private:
+	struct Batch
+	{
+		vk::Fence	   fence;
+		vk::DeviceSize end;	   // Where the ring's head was when the batch closed
+	};
+
+	Device*				   device;
+	BufferHandle		   buffer;
+	vk::Buffer			   vk_buffer;
+	char*				   mapped;
+	vk::DeviceSize		   capacity;
+	vk::DeviceSize		   head		 = 0;		 // Next byte to hand out
+	vk::DeviceSize		   tail		 = 0;		 // First byte still read by a batch in flight
+	bool				   open		 = false;	 // Ranges were handed out since the last EndBatch
+	std::deque<Batch>	   in_flight;			 // Oldest first
+	std::vector<vk::Fence> free_fences;
+
+	void RetireBatch();
+};
+
+}	 // namespace nft::vulkan
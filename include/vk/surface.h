@@ -4,11 +4,17 @@
 #include "core/app.h"
 #include "core/error.h"
 #include "gui/window.h"
+#include "vk/buffer.h"
 #include "vk/common.h"
+#include "vk/frustum_culler.h"
+#include "vk/meshlet.h"
+#include "vk/render_queue.h"
 #include "vk/shader.h"
 #include "vk/util.h"
 #include "core/glfw_common.h"
 
+#include <functional>
+
 namespace nft::vulkan
 {
 // Forward declarations
@@ -21,7 +27,7 @@ class Device;
 class ObjectPicker
 {
   public:
-	ObjectPicker(Device* device, vk::Extent2D extent);
+	ObjectPicker(Device* device, vk::Extent2D extent, VertexFormat vertex_format);
 	~ObjectPicker();
 
 	void Init();
@@ -39,6 +45,7 @@ class ObjectPicker
   private:
 	Device*		 device;
 	vk::Extent2D extent;
+	VertexFormat vertex_format;	   // Must match the geometry batcher's vertex buffer
 
 	// Offscreen render resources
 	Image			color_attachment;
@@ -70,7 +77,7 @@ class ObjectPicker
 	std::vector<ShaderStage> picking_shader_stages;
 
 	// Buffer for reading back pixel data
-	Buffer* readback_buffer = nullptr;
+	BufferHandle readback_buffer;
 
 	// Command buffer for picking operations
 	vk::CommandBuffer command_buffer = VK_NULL_HANDLE;
@@ -111,6 +118,37 @@ class Surface
 		glm::vec3 pos;
 	};
 
+	// Draw of one object before GPU culling (std430, read by cull_shader.comp)
+	struct CullObject
+	{
+		glm::vec3 bounds_min;	 // Box around the stored vertex positions, in the space of the object transform
+		uint32_t  index_count;
+		glm::vec3 bounds_max;
+		uint32_t  first_index;
+		int32_t	  vertex_offset;
+		uint32_t  instance_index;
+		uint32_t  padding[2];
+	};
+
+	// Objects drawn together: same mesh and level of detail. Their transforms and material indices sit
+	// at instance indices [first_instance, first_instance + instance_count) of the frame's buffers.
+	struct InstanceBucket
+	{
+		const IMesh* mesh;
+		uint32_t	 level;
+		uint32_t	 first_instance;
+		uint32_t	 instance_count;
+	};
+
+	struct CullPushConstants
+	{
+		glm::vec4 planes[6];	// World space, normalized, pointing inwards
+		uint32_t  short_count;	// 16-bit index draws, from the start of the buffers
+		uint32_t  long_start;	// First 32-bit index draw
+		uint32_t  long_count;
+		uint32_t  compact;		// Append visible draws and count them, for drawIndexedIndirectCount
+	};
+
 	// Individual frame data for rendering
 	struct Frame
 	{
@@ -124,19 +162,41 @@ class Surface
 		uint32_t				  height;
 
 		vk::CommandBuffer vk_command_buffer = VK_NULL_HANDLE;
+		uint64_t		  submitted_frame	= 0;	// Deletion queue serial of the last submission
 
 		// synchronization
 		vk::Fence	  in_flight_fence			= VK_NULL_HANDLE;
 		vk::Semaphore image_available_semaphore = VK_NULL_HANDLE;
 		vk::Semaphore render_finished_semaphore = VK_NULL_HANDLE;
+		vk::Fence	  present_fence				= VK_NULL_HANDLE;	// Signals once the image's last present is done
+		uint64_t	  presented					= 0;				// Serial of the image's last present
 
 		// resources
 		UniformBufferObject	   camera_data;
-		Buffer*				   camera_data_buffer = nullptr;
-		void*				   camera_data_ptr	  = nullptr;
-		std::vector<glm::mat4> object_transforms;
-		Buffer*				   object_transform_buffer = nullptr;
-		void*				   object_transform_ptr	   = nullptr;
+		BufferHandle		   camera_data_buffer;
+		void*				   camera_data_ptr = nullptr;
+		BufferHandle		   object_transform_buffer;	   // Transform per instance
+		void*				   object_transform_ptr = nullptr;
+
+		// Indirect draw resources, grown as the scene does
+		BufferHandle object_material_buffer;	// Material index per instance
+		void*		 object_material_ptr = nullptr;
+		BufferHandle material_buffer;	 // Scene materials, then the default material
+		void*		 material_ptr			   = nullptr;
+		uint32_t	 materials_version		   = 0;	   // Scene materials version packed into material_buffer
+		BufferHandle indirect_command_buffer;	 // 16-bit index draws from the front, 32-bit from the back
+		void*		 indirect_command_ptr	   = nullptr;
+		size_t		 indirect_command_capacity = 0;
+		size_t		 indirect_short_count	   = 0;	   // Draws written this frame, before culling
+		size_t		 indirect_long_count	   = 0;
+		bool		 indirect_counted		   = false;	   // Compacted by the culling pass; draw counts are on the GPU
+
+		// GPU culling resources; candidates sit at the same slots as the commands they turn into
+		BufferHandle	  cull_object_buffer;
+		void*			  cull_object_ptr = nullptr;
+		BufferHandle	  draw_count_buffer;	// Visible 16-bit and 32-bit index draws
+		void*			  draw_count_ptr  = nullptr;
+		vk::DescriptorSet cull_descriptor_set = VK_NULL_HANDLE;
 
 		// resource descriptors
 		vk::DescriptorSet vk_descriptor_set = VK_NULL_HANDLE;	 // Frame data (camera + transforms)
@@ -166,6 +226,8 @@ class Surface
 	void Init();
 	void InitSwapchain();
 	void CleanupSwapchain();
+	// Releases what waited for presents that are now known to be done
+	void RetirePresents();
 	void Cleanup();	   // Explicit cleanup method
 
 	void SetDevice(Device* device);
@@ -177,6 +239,22 @@ class Surface
 	void PrepareScene(vk::CommandBuffer command_buffer);
 	void Render();
 	void RecordDrawCommands(Frame& frame, uint32_t image_index);
+	// Buckets the objects into instances and writes their transforms and material indices; objects not set in
+	// visible are left out
+	void WriteInstances(Frame& frame, float lod_pixel_scale, const std::vector<uint8_t>* visible);
+	// Writes a draw command per bucket, or with GPU culling a candidate per instance and the culling dispatch.
+	// Recorded before the render pass.
+	void WriteIndirectDraws(Frame& frame, vk::CommandBuffer command_buffer);
+	// Submits the frame's draw commands with one drawIndexedIndirect(Count) per index type
+	void RecordIndirectDraws(Frame& frame, vk::CommandBuffer command_buffer);
+
+	// Indirect draws need drawIndirectFirstInstance; without it the direct path is used either way
+	void SetIndirectDraws(bool enabled) { indirect_draws = enabled; }
+	bool UsesIndirectDraws() const { return indirect_draws && supports_indirect_draws; }
+	// Frustum culling of the indirect draws in a compute pass; without drawIndirectCount culled draws are
+	// kept with an instance count of 0
+	void SetGpuCulling(bool enabled) { gpu_culling = enabled; }
+	bool UsesGpuCulling() const { return gpu_culling && vk_cull_pipeline && UsesIndirectDraws(); }
 
 	//=========================================================================
 	// OBJECT PICKING METHODS
@@ -190,7 +268,9 @@ class Surface
 	void CreateSwapchain();
 	void RecreateSwapchain();
 	void CreatePipeline();
+	void CreateCullPipeline();			  // Compute pipeline of the GPU culling pass
 	void CreateTextureDescriptorSet();	  // Create descriptor set for material textures
+	void UpdateTextureDescriptorSet();	  // Rewrite it after textures were replaced (GPU must be idle)
 	void CreateFrameBuffers();
 	void CreateCommandPool();
 	void CreateFrameCommandBuffers();
@@ -218,6 +298,20 @@ class Surface
 	const vk::PresentModeKHR&	   GetPresentMode() const { return present_mode; }
 	const std::vector<Frame>&	   GetFrames() const { return frames; }
 
+	// Object and cluster culling results of the last directly drawn frame
+	const FrustumCuller::Stats& GetFrustumStats() const { return frustum_culler.GetStats(); }
+	const MeshletCuller::Stats& GetMeshletStats() const { return meshlet_culler.GetStats(); }
+	// Draws sorted and binds skipped in the last recorded frame
+	const RenderQueue::Stats&	GetRenderQueueStats() const { return render_queue.GetStats(); }
+	void						SetLodPixelError(float pixels) { lod_pixel_error = pixels; }
+
+	// The geometry arena is compacted a budget's worth per frame once its fragmentation passes the threshold
+	void SetGeometryCompaction(float fragmentation_threshold, size_t bytes_per_frame)
+	{
+		compaction_threshold = fragmentation_threshold;
+		compaction_budget	 = bytes_per_frame;
+	}
+
 	//=========================================================================
 	// UTILITY METHODS
 	//=========================================================================
@@ -279,7 +373,8 @@ class Surface
 
 	// Swapchain data
 	SwapchainSupportDetails	   support_details;
-	vk::SwapchainKHR		   vk_swapchain = VK_NULL_HANDLE;
+	vk::SwapchainKHR		   vk_swapchain	 = VK_NULL_HANDLE;
+	vk::SwapchainKHR		   old_swapchain = VK_NULL_HANDLE;	  // Being replaced; handed to its successor, then retired
 	std::vector<Frame>		   frames;
 	vk::Extent2D			   extent	   = vk::Extent2D(0, 0);
 	uint32_t				   image_count = 0;
@@ -288,6 +383,19 @@ class Surface
 	vk::PresentModeKHR		   present_mode;
 	vk::SwapchainCreateInfoKHR vk_swapchain_info;
 
+	// Presents wait on the render finished semaphores, which frame fences don't cover. Those of a replaced
+	// swapchain, and the swapchain itself, wait here until their presents are known to be done: by a present fence,
+	// or by an image being acquired again, as presents complete in the order they were queued.
+	struct PresentRetirement
+	{
+		uint64_t			  present;	  // Serial of the last present that may still use it
+		vk::Fence			  fence;	  // That present's fence, if presents have them
+		std::function<void()> destroy;
+	};
+	std::vector<PresentRetirement> present_retirements;
+	uint64_t					   present_count	  = 0;	  // Presents queued so far
+	uint64_t					   completed_presents = 0;	  // Presents known to be done
+
 	// Command objects
 	vk::CommandPool			  vk_command_pool	= VK_NULL_HANDLE;
 	vk::CommandBuffer		  vk_command_buffer = VK_NULL_HANDLE;
@@ -317,6 +425,38 @@ class Surface
 	size_t				   frame_index = 0;
 	std::unique_ptr<Scene> scene;
 	vk::DescriptorSet	   texture_descriptor_set = VK_NULL_HANDLE;	   // Global texture descriptor set
+	uint32_t			   textures_version		  = 0;				   // Scene textures version written to it
+
+	// Object and cluster culling, and level of detail
+	FrustumCuller						   frustum_culler;
+	std::vector<uint8_t>				   visible_objects;			 // Per scene object, reused between frames
+	MeshletCuller						   meshlet_culler;
+	std::vector<MeshletCuller::IndexRange> visible_ranges;			 // Reused between draws
+	float								   lod_pixel_error = 1.0f;	 // Largest on-screen LOD error, in pixels
+
+	// Instancing, rebuilt every frame from the sorted render queue
+	RenderQueue					render_queue;
+	std::vector<InstanceBucket> instance_buckets;
+	std::vector<uint32_t>		instance_objects;	 // Object of each instance index
+	std::vector<uint32_t>		object_levels;		 // Level of detail per object
+
+	// Indirect draws
+	bool								 indirect_draws			 = true;
+	bool								 supports_indirect_draws = false;	 // drawIndirectFirstInstance
+	std::vector<vk::DrawIndirectCommand> unindexed_draws;					 // Meshes without indices, drawn directly
+
+	// GPU culling
+	bool				gpu_culling = true;
+	ShaderStage			cull_shader_stage;
+	DescriptorSetLayout cull_set_layout;
+	DescriptorPool		cull_descriptor_pool;
+	PipelineLayout		cull_pipeline_layout;
+	vk::Pipeline		vk_cull_pipeline = VK_NULL_HANDLE;
+
+	// Geometry arena compaction
+	float  compaction_threshold = 0.5f;		  // Fragmentation at which compaction starts
+	size_t compaction_budget	= 4 << 20;	  // Bytes moved per frame
+	bool   compacting			= false;	  // Keeps going until done once started, even below the threshold
 
 	// Object picking
 	std::unique_ptr<ObjectPicker> object_picker;
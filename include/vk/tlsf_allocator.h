@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+// Two-level segregated fit allocator over the offsets [0, capacity). Free ranges are binned by size class (a power
+// of two, split linearly into 16 steps) and the bins are found through two bitmaps, so Allocate and Free take
+// constant time no matter how many ranges there are. Freed ranges merge with free neighbours right away. Like
+// RangeAllocator it only does the bookkeeping; the memory lives elsewhere.
+class TlsfAllocator
+{
+  public:
+	static constexpr uint32_t invalid = UINT32_MAX;
+
+	struct Allocation
+	{
+		size_t	 offset = 0;
+		uint32_t node	= invalid;	  // Hand back to Free; invalid if the allocation failed
+	};
+
+	explicit TlsfAllocator(size_t capacity);
+
+	Allocation Allocate(size_t size, size_t alignment = 1);
+	void	   Free(uint32_t node);
+
+	size_t GetCapacity() const { return capacity; }
+	size_t GetUsed() const { return used; }
+	bool   IsEmpty() const { return used == 0; }
+
+  private:
+	static constexpr uint32_t sl_bits  = 4;
+	static constexpr uint32_t sl_count = 1 << sl_bits;
+	static constexpr uint32_t fl_count = 64;
+
+	// A range of the allocator, free or in use, linked to its physical neighbours and, while free, to the other
+	// ranges of its bin
+	struct Node
+	{
+		size_t	 offset;
+		size_t	 size;
+		uint32_t prev_physical = invalid;
+		uint32_t next_physical = invalid;
+		uint32_t prev_free	   = invalid;
+		uint32_t next_free	   = invalid;
+		bool	 free		   = false;
+	};
+
+	size_t												 capacity;
+	size_t												 used = 0;
+	std::vector<Node>									 nodes;
+	std::vector<uint32_t>								 unused_nodes;	  // Slots of merged nodes, reused first
+	uint64_t											 fl_bitmap = 0;	  // Size classes with a non-empty bin
+	std::array<uint32_t, fl_count>						 sl_bitmaps {};	  // Non-empty bins per size class
+	std::array<std::array<uint32_t, sl_count>, fl_count> free_heads;
+
+	static void Mapping(size_t size, uint32_t& fl, uint32_t& sl);
+
+	uint32_t NewNode(size_t offset, size_t size);
+	void	 InsertFree(uint32_t node);
+	void	 RemoveFree(uint32_t node);
+	uint32_t FindFree(size_t size) const;	 // A free node of at least size, from the smallest bin that guarantees it
+};
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "vk/common.h"
+
+#include <deque>
+#include <vector>
+
+namespace nft::vulkan
+{
+class Device;
+
+// Records uploads on the device's transfer queue and submits them without waiting. Each submission signals the
+// next value of a timeline semaphore, which frames wait for on the GPU before reading what was uploaded.
+//
+// With a dedicated transfer family, images change queue family ownership: ReleaseImage records the release on
+// the transfer queue and keeps the matching acquire, which RecordAcquires adds to the next frame. Buffers the
+// uploads write into are created concurrent instead, so they can be read while other ranges are written.
+// Devices without timeline semaphores get the same interface, but every submission is waited for on the CPU.
+class UploadScheduler
+{
+  public:
+	explicit UploadScheduler(Device* device);
+	~UploadScheduler();
+
+	// A command buffer on the upload queue, ready to record into; hand it to Submit when done
+	vk::CommandBuffer Begin();
+	// Submits the command buffer from Begin, also signaling fence if given. Returns the timeline value it signals.
+	uint64_t		  Submit(vk::Fence fence = nullptr);
+
+	// Moves an image uploaded in command_buffer to new_layout, ready for the graphics queue's fragment shaders
+	void ReleaseImage(vk::CommandBuffer			command_buffer,
+					  vk::Image					image,
+					  vk::ImageSubresourceRange range,
+					  vk::ImageLayout			old_layout,
+					  vk::ImageLayout			new_layout);
+	// Records the acquires for images released since the last call; command_buffer must wait for the timeline
+	// value of the releases at GetWaitStages()
+	void RecordAcquires(vk::CommandBuffer command_buffer);
+
+	bool	 IsComplete(uint64_t value) const;
+	void	 Wait(uint64_t value);
+	void	 WaitIdle() { Wait(submitted_value); }
+	uint64_t GetSubmittedValue() const { return submitted_value; }
+
+	bool				   UsesTimeline() const { return timeline; }
+	vk::Semaphore		   GetSemaphore() const { return semaphore; }
+	vk::PipelineStageFlags GetWaitStages() const;
+	// Image copies must start at multiples of this; 0 means only whole images can be copied
+	vk::Extent3D		   GetImageGranularity() const { return image_granularity; }
+
+  private:
+	struct Pending
+	{
+		vk::CommandBuffer command_buffer;
+		uint64_t		  value;
+	};
+
+	Device*			device;
+	vk::Queue		queue;
+	uint32_t		queue_family;
+	uint32_t		graphics_family;
+	bool			timeline;
+	vk::Extent3D	image_granularity;
+	vk::Semaphore	semaphore	 = VK_NULL_HANDLE;
+	vk::Fence		wait_fence	 = VK_NULL_HANDLE;	// Waited on after each submission without timeline semaphores
+	vk::CommandPool	command_pool = VK_NULL_HANDLE;
+
+	vk::CommandBuffer					recording		= VK_NULL_HANDLE;
+	std::deque<Pending>					pending;	// Submitted command buffers, oldest first
+	std::vector<vk::CommandBuffer>		free_command_buffers;
+	std::vector<vk::ImageMemoryBarrier>	acquires;
+	uint64_t							submitted_value	= 0;
+	uint64_t							completed_value	= 0;	// Only tracked without timeline semaphores
+};
+
+}	 // namespace nft::vulkan
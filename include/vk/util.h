@@ -8,6 +8,7 @@
 
 #include "vk/Common.h"
 #include "vk/Shader.h"
+#include "vk/vertex_format.h"
 
 namespace nft::vulkan
 {
@@ -49,11 +50,17 @@ namespace nft::vulkan
 	struct VertexInputStage: public PipelineStage
 	{
 		VertexInputStage(Device* device) : PipelineStage(device) {}
-		void Init();
+		void Init(VertexFormat format = VertexFormat::Full);
 
 		vk::PipelineVertexInputStateCreateInfo			 vk_vertex_input_info;
 		vk::VertexInputBindingDescription				 binding_description;
 		std::vector<vk::VertexInputAttributeDescription> attribute_descriptions;
+
+		// Vertex shader specialization (constant_id 0: compact vertices with octahedral normals)
+		VertexFormat			   format			= VertexFormat::Full;
+		VkBool32				   compact_vertices = VK_FALSE;
+		vk::SpecializationMapEntry specialization_entry;
+		vk::SpecializationInfo	   vk_specialization_info;
 	};
 
 	// Input assembly stage
@@ -156,7 +163,8 @@ namespace nft::vulkan
 	struct PipelineLayout
 	{
 		PipelineLayout(Device* device) : device(device) {}
-		void Init(std::vector<vk::DescriptorSetLayout> descriptor_set_layouts, vk::PushConstantRange push_constant_range);
+		void Init(std::vector<vk::DescriptorSetLayout> descriptor_set_layouts,
+				  std::vector<vk::PushConstantRange>  push_constant_ranges = {});
 		void Cleanup();
 
 		vk::PipelineLayout			 vk_pipeline_layout = VK_NULL_HANDLE;
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "vk/mesh_cache.h"
+
+#include <glm/glm.hpp>
+#include <span>
+
+namespace nft::vulkan
+{
+
+// Layout of the vertices in the GPU vertex buffer. Meshes always keep MeshCache::vertex_stride floats on the CPU
+// and in their .nftmesh cache; GeometryBatcher packs them into the selected format while filling staging memory.
+enum class VertexFormat : uint32_t
+{
+	Full,		// 48 bytes: float3 position, float4 color, float2 texture coordinate, float3 normal
+	Compact,	// 20 bytes: unorm16x4 position in mesh bounds, unorm8x4 color, half2 texture coordinate, octahedral snorm16x2 normal
+};
+
+struct CompactVertex
+{
+	uint32_t position_xy;	   // unorm16 x, y relative to the mesh bounds
+	uint32_t position_zw;	   // unorm16 z, w is padding
+	uint32_t color;			   // unorm8 r, g, b, a
+	uint32_t texture_coord;	   // half u, v
+	uint32_t normal;		   // snorm16 octahedral x, y
+};
+static_assert(sizeof(CompactVertex) == 20);
+
+uint32_t GetVertexSize(VertexFormat format);
+
+Bounds ComputeBounds(std::span<const float> vertices);
+
+// Sphere (center, radius) around the bounds center that encloses every vertex; tighter than the box's own
+// circumscribed sphere for most meshes
+glm::vec4 ComputeBoundingSphere(std::span<const float> vertices, const Bounds& bounds);
+
+// Maps unorm positions in [0, 1] back onto the bounds. Compact meshes fold this into their object transform,
+// so the shaders never dequantize positions themselves
+glm::mat4 GetDequantizeTransform(const Bounds& bounds);
+
+glm::vec2 OctEncode(glm::vec3 normal);
+
+// Packs interleaved vertices (MeshCache::vertex_stride floats each) into dst, which must hold
+// GetVertexSize(format) bytes per vertex
+void PackVertices(std::span<const float> vertices, const Bounds& bounds, VertexFormat format, void* dst);
+
+}	 // namespace nft::vulkan
@@ -75,6 +75,8 @@ void Logger::Print(const std::string& message,
 		}
 		if (display_flags & Log::Flags::IndentMessage)
 			for (uint16_t i = 0; i < message_indent; i++) { message_final.insert(0, " "); }
+
+		std::lock_guard lock(print_mutex);
 		if (!(display_flags & Log::Flags::MessageOnNewLine))
 			std::print("\x1b[{}m{}{}\x1b[0m", color_str, header_final, message_final);
 		else
@@ -0,0 +1,156 @@
+#include "core/mapped_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace nft
+{
+
+MappedFile::MappedFile(const std::string& file_path)
+{
+	Open(file_path);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept:
+	data(std::exchange(other.data, nullptr)),
+	size(std::exchange(other.size, 0)),
+	is_open(std::exchange(other.is_open, false)),
+#ifdef _WIN32
+	file_handle(std::exchange(other.file_handle, nullptr)),
+	mapping_handle(std::exchange(other.mapping_handle, nullptr))
+#else
+	file_descriptor(std::exchange(other.file_descriptor, -1))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	Close();
+	data	= std::exchange(other.data, nullptr);
+	size	= std::exchange(other.size, 0);
+	is_open = std::exchange(other.is_open, false);
+#ifdef _WIN32
+	file_handle	   = std::exchange(other.file_handle, nullptr);
+	mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#else
+	file_descriptor = std::exchange(other.file_descriptor, -1);
+#endif
+	return *this;
+}
+
+bool MappedFile::Open(const std::string& file_path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(file_path.c_str(),
+							  GENERIC_READ,
+							  FILE_SHARE_READ,
+							  nullptr,
+							  OPEN_EXISTING,
+							  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+							  nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	file_handle = file;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(file_size.QuadPart);
+
+	// Zero-length files cannot be mapped, but are still valid (empty) files
+	if (size > 0)
+	{
+		mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping_handle)
+		{
+			Close();
+			return false;
+		}
+
+		data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+		if (!data)
+		{
+			Close();
+			return false;
+		}
+	}
+#else
+	file_descriptor = open(file_path.c_str(), O_RDONLY);
+	if (file_descriptor < 0)
+		return false;
+
+	struct stat file_stat;
+	if (fstat(file_descriptor, &file_stat) != 0)
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(file_stat.st_size);
+
+	// Zero-length files cannot be mapped, but are still valid (empty) files
+	if (size > 0)
+	{
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+		if (mapping == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+		data = static_cast<const char*>(mapping);
+		madvise(mapping, size, MADV_SEQUENTIAL);
+	}
+#endif
+
+	is_open = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping_handle)
+		CloseHandle(mapping_handle);
+	if (file_handle)
+		CloseHandle(file_handle);
+	mapping_handle = nullptr;
+	file_handle	   = nullptr;
+#else
+	if (data)
+		munmap(const_cast<char*>(data), size);
+	if (file_descriptor >= 0)
+		close(file_descriptor);
+	file_descriptor = -1;
+#endif
+	data	= nullptr;
+	size	= 0;
+	is_open = false;
+}
+
+}	 // namespace nft
@@ -1,18 +1,210 @@
 #include "core/parse_obj.h"
 
 #include "core/error.h"
+#include "core/mapped_file.h"
 #include "core/string.h"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <chrono>
 #include <fstream>
+#include <future>
+#include <thread>
 
 namespace nft::parse
 {
 
-ObjLoader::ObjLoader(const std::string& file_dir, const std::string& file_name)
+struct ObjLoader::Chunk
+{
+	enum class RecordType : uint8_t
+	{
+		Face,
+		UseMaterial,
+		MaterialLibrary,
+		Error
+	};
+
+	struct Record
+	{
+		RecordType type;
+		uint32_t   count;	 // Corner count for faces, otherwise an index into strings
+
+		// Attribute counts of this chunk when the record was read, used to resolve relative indices
+		uint32_t v_count;
+		uint32_t vt_count;
+		uint32_t vn_count;
+	};
+
+	std::vector<glm::vec3>	 v;
+	std::vector<glm::vec3>	 vn;
+	std::vector<glm::vec2>	 vt;
+	std::vector<Corner>		 corners;	 // Face corners of all Face records, in order
+	std::vector<Record>		 records;
+	std::vector<std::string> strings;	 // Material names and error messages
+
+	void AddRecord(RecordType type, uint32_t count)
+	{
+		records.push_back({ type, count, uint32_t(v.size()), uint32_t(vt.size()), uint32_t(vn.size()) });
+	}
+
+	void AddString(RecordType type, std::string string)
+	{
+		AddRecord(type, uint32_t(strings.size()));
+		strings.push_back(std::move(string));
+	}
+};
+
+namespace
+{
+// Chunks smaller than this are not worth a thread of their own
+constexpr size_t min_chunk_size = 1 << 20;
+
+// When streaming, parsed records are merged once this many face corners are pending
+constexpr size_t stream_merge_corners = 1 << 16;
+
+// Calls fn with the words of every non-empty, non-comment line in text
+template<typename Fn>
+void ForEachLineIn(std::string_view text, std::vector<std::string_view>& words, Fn&& fn)
+{
+	const char* cursor = text.data();
+	const char* end	   = cursor + text.size();
+	while (cursor < end)
+	{
+		size_t		newline	 = string::FindChar(std::string_view(cursor, end - cursor), '\n');
+		const char* line_end = newline == std::string_view::npos ? end : cursor + newline;
+
+		string::SplitWhitespace(std::string_view(cursor, line_end - cursor), words);
+		if (!words.empty() && words[0][0] != '#')	 // Skip empty lines and comments
+			fn(words);
+
+		cursor = line_end + 1;
+	}
+}
+
+bool ParseFloat(std::string_view word, float& value)
+{
+	// from_chars rejects a leading '+', which stof accepted
+	if (!word.empty() && word.front() == '+')
+		word.remove_prefix(1);
+
+	auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+	return error == std::errc() && end == word.data() + word.size();
+}
+
+bool ParseIndex(std::string_view word, int32_t& value)
+{
+	if (!word.empty() && word.front() == '+')
+		word.remove_prefix(1);
+
+	auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+	return error == std::errc() && end == word.data() + word.size();
+}
+
+bool ParseFloats(const std::vector<std::string_view>& words, size_t count, float* values)
+{
+	if (words.size() < count + 1)
+		return false;
+	for (size_t i = 0; i < count; ++i)
+		if (!ParseFloat(words[i + 1], values[i]))
+			return false;
+	return true;
+}
+
+// Resolves a 1-based or relative (negative) OBJ index against the number of elements read so far.
+// Returns 0 if the index is absent or out of range.
+int32_t ResolveIndex(int32_t index, size_t count)
+{
+	int64_t resolved = index < 0 ? int64_t(count) + index + 1 : index;
+	return resolved >= 1 && resolved <= int64_t(count) ? int32_t(resolved) : 0;
+}
+}	 // namespace
+
+void ObjLoader::CornerTable::Reserve(size_t count)
+{
+	// Keep the load factor at or below 3/4
+	size_t capacity = std::bit_ceil(std::max<size_t>(16, count + count / 3 + 1));
+	if (capacity > slots.size())
+		Rehash(capacity);
+}
+
+void ObjLoader::CornerTable::Clear()
+{
+	std::fill(slots.begin(), slots.end(), Slot {});
+	size = 0;
+}
+
+std::pair<uint32_t, bool> ObjLoader::CornerTable::FindOrInsert(const CornerKey& key, uint32_t next_index)
+{
+	if ((size + 1) * 4 > slots.size() * 3)
+		Rehash(std::max<size_t>(16, slots.size() * 2));
+
+	size_t mask = slots.size() - 1;
+	for (size_t slot = Hash(key) & mask;; slot = (slot + 1) & mask)
+	{
+		if (slots[slot].key == key)
+			return { slots[slot].index, false };
+
+		if (slots[slot].key.position_texcoord == 0)
+		{
+			slots[slot] = { key, next_index };
+			++size;
+			return { next_index, true };
+		}
+	}
+}
+
+size_t ObjLoader::CornerTable::Hash(const CornerKey& key)
+{
+	uint64_t hash = key.position_texcoord * 0x9E3779B97F4A7C15ull;
+	hash ^= (key.normal_material + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+	return size_t(hash ^ (hash >> 32));
+}
+
+void ObjLoader::CornerTable::Rehash(size_t capacity)
+{
+	std::vector<Slot> old_slots(capacity);
+	std::swap(slots, old_slots);
+
+	size_t mask = slots.size() - 1;
+	for (const Slot& old_slot : old_slots)
+	{
+		if (old_slot.key.position_texcoord == 0)
+			continue;
+
+		size_t slot = Hash(old_slot.key) & mask;
+		while (slots[slot].key.position_texcoord != 0)
+			slot = (slot + 1) & mask;
+		slots[slot] = old_slot;
+	}
+}
+
+ObjLoader::ObjLoader(const std::string& file_dir, const std::string& file_name, ParseMode mode): mode(mode)
 {
 	vertices = std::make_unique<std::vector<float>>();
 	indices	 = std::make_unique<std::vector<uint32_t>>();
+
+	auto start = std::chrono::steady_clock::now();
+	ParseObjFile(file_dir, file_name);
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+ObjLoader::ObjLoader(const std::string& file_dir,
+					 const std::string& file_name,
+					 ChunkSink			sink,
+					 size_t				max_chunk_vertices,
+					 ParseMode			mode):
+	mode(mode == ParseMode::Parallel ? ParseMode::Mapped : mode), sink(std::move(sink)), max_chunk_vertices(std::max<size_t>(max_chunk_vertices, 3))
+{
+	vertices = std::make_unique<std::vector<float>>();
+	indices	 = std::make_unique<std::vector<uint32_t>>();
+	vertices->reserve(this->max_chunk_vertices * 12);
+	index_history.Reserve(this->max_chunk_vertices);
+
+	auto start = std::chrono::steady_clock::now();
 	ParseObjFile(file_dir, file_name);
+	FlushChunk();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
 std::unique_ptr<std::vector<float>> ObjLoader::GetVertices()
@@ -29,143 +221,342 @@ std::unique_ptr<std::vector<uint32_t>> ObjLoader::GetIndices()
 	return std::move(indices);
 }
 
-void ObjLoader::ParseObjFile(const std::string& file_dir, const std::string& file_name)
+template<typename Fn>
+bool ObjLoader::ForEachLine(const std::string& file_path, Fn&& fn)
 {
-	std::string				 file_path = file_dir + "/" + file_name;
-	std::string				 line;
-	std::vector<std::string> words;
+	Words words;
+
+	if (mode != ParseMode::Stream)
+	{
+		MappedFile file(file_path);
+		if (!file.IsOpen())
+			return false;
+
+		ForEachLineIn(file.GetView(), words, fn);
+		stats.bytes += file.GetSize();
+		return true;
+	}
 
-	std::ifstream file(file_path);
+	std::ifstream file(file_path, std::ios::binary);
 	if (!file.is_open())
-		NFT_ERROR(FileError, "Failed to open OBJ file: " + file_path);
+		return false;
 
+	std::string line;
 	while (std::getline(file, line))
 	{
-		words = string::split(line, " ");
-
-		if (words.empty() || words[0].empty() || words[0][0] == '#')	// Skip empty lines and comments
-			continue;
-
-		if (!words[0].compare("mtllib"))
-			ParseMtlFile(file_dir, words[1]);
+		string::SplitWhitespace(line, words);
+		if (!words.empty() && words[0][0] != '#')	 // Skip empty lines and comments
+			fn(words);
 
-		if (!words[0].compare("v"))
-			ReadVertexData(words);
+		stats.bytes += line.size() + 1;
+	}
 
-		if (!words[0].compare("vt"))
-			ReadTextureCoordData(words);
+	file.close();
+	return true;
+}
 
-		if (!words[0].compare("vn"))
-			ReadNormalData(words);
+void ObjLoader::ParseObjFile(const std::string& file_dir, const std::string& file_name)
+{
+	std::string file_path = file_dir + "/" + file_name;
 
-		if (!words[0].compare("usemtl"))
+	if (mode != ParseMode::Parallel)
+	{
+		Chunk chunk;
+		bool  opened = ForEachLine(file_path,
+								   [&](const Words& words)
+								   {
+									   ParseObjRecord(chunk, words);
+
+									   // Keep the pending records bounded while streaming
+									   if (sink && chunk.corners.size() >= stream_merge_corners)
+									   {
+										   MergeChunk(file_dir, chunk);
+										   chunk = Chunk();
+									   }
+								   });
+		if (!opened)
 		{
-			if (colors.contains(words[1]))
-				brush_color = colors[words[1]];	   // Use the color from the material
-			else
-				brush_color = glm::vec3(1.0);	 // Use the color from the material
+			NFT_ERROR(FileError, "Failed to open OBJ file: " + file_path);
+			return;
 		}
+		MergeChunk(file_dir, chunk);
+		return;
+	}
 
-		if (!words[0].compare("f"))
-			ReadFaceData(words);
+	MappedFile file(file_path);
+	if (!file.IsOpen())
+	{
+		NFT_ERROR(FileError, "Failed to open OBJ file: " + file_path);
+		return;
 	}
+	stats.bytes += file.GetSize();
 
-	file.close();
+	// Split the file into roughly equal slices, moving each cut to just past the next newline
+	std::string_view text		 = file.GetView();
+	size_t			 chunk_count = std::clamp<size_t>(text.size() / min_chunk_size, 1, std::max(1u, std::thread::hardware_concurrency()));
+
+	std::vector<std::string_view> slices;
+	size_t						  slice_start = 0;
+	for (size_t i = 1; i <= chunk_count && slice_start < text.size(); ++i)
+	{
+		size_t slice_end = i == chunk_count ? text.size() : std::max(slice_start, text.size() * i / chunk_count);
+		slice_end		 = std::min(text.find('\n', slice_end), text.size());
+		if (slice_end < text.size())
+			++slice_end;
+
+		slices.push_back(text.substr(slice_start, slice_end - slice_start));
+		slice_start = slice_end;
+	}
+
+	std::vector<Chunk>			   chunks(slices.size());
+	std::vector<std::future<void>> jobs;
+	jobs.reserve(slices.size());
+	for (size_t i = 0; i < slices.size(); ++i)
+		jobs.push_back(std::async(std::launch::async, [this, &chunks, &slices, i]() { ParseChunk(chunks[i], slices[i]); }));
+
+	// Merge in file order as soon as each chunk is done, overlapping with the chunks still being parsed
+	for (size_t i = 0; i < chunks.size(); ++i)
+	{
+		jobs[i].get();
+		MergeChunk(file_dir, chunks[i]);
+		chunks[i] = Chunk();
+	}
 }
 
 void ObjLoader::ParseMtlFile(const std::string& file_dir, const std::string& file_name)
 {
-	std::string				 file_path = file_dir + "/" + file_name;
-	std::string				 line;
-	std::vector<std::string> words;
-
-	std::ifstream file(file_path);
-	if (!file.is_open())
-		NFT_ERROR(FileError, "Failed to open MTL file: " + file_path);
-
+	std::string file_path = file_dir + "/" + file_name;
 	std::string material_name;
+	if (std::find(material_libraries.begin(), material_libraries.end(), file_path) == material_libraries.end())
+		material_libraries.push_back(file_path);
 
-	while (std::getline(file, line))
-	{
-		words = string::split(line, " ");
+	if (!ForEachLine(file_path, [&](const Words& words) { ParseMtlRecord(words, material_name); }))
+		NFT_ERROR(FileError, "Failed to open MTL file: " + file_path);
+}
 
-		if (words.empty() || words[0].empty() || words[0][0] == '#')	// Skip empty lines and comments
-			continue;
+void ObjLoader::ParseMtlRecord(const Words& words, std::string& material_name)
+{
+	const std::string_view keyword = words[0];
 
-		if (!words[0].compare("newmtl"))
-			material_name = words[1];
+	if (keyword == "newmtl" && words.size() > 1)
+		material_name = words[1];
 
-		if (!words[0].compare("Kd"))
+	if (keyword == "Kd")
+	{
+		float kd[3];
+		if (!ParseFloats(words, 3, kd))
 		{
-			brush_color			  = glm::vec3(std::stof(words[1]), std::stof(words[2]), std::stof(words[3]));
-			colors[material_name] = brush_color;	// Store the color for the material
+			NFT_ERROR(ParseError, "Invalid diffuse color for material: " + material_name);
+			return;
 		}
-	}
 
-	file.close();
+		brush_color			  = glm::vec3(kd[0], kd[1], kd[2]);
+		colors[material_name] = brush_color;	// Store the color for the material
+	}
 }
 
-void ObjLoader::ReadVertexData(const std::vector<std::string>& words)
+void ObjLoader::ParseChunk(Chunk& chunk, std::string_view text) const
 {
-	glm::vec4 new_vertex		 = glm::vec4(std::stof(words[1]), std::stof(words[2]), std::stof(words[3]), 1.0f);
-	glm::vec3 transformed_vertex = pre_transform * new_vertex;
-	v.push_back(transformed_vertex);
+	Words words;
+	ForEachLineIn(text, words, [&](const Words& words) { ParseObjRecord(chunk, words); });
 }
 
-void ObjLoader::ReadTextureCoordData(const std::vector<std::string>& words)
+void ObjLoader::ParseObjRecord(Chunk& chunk, const Words& words) const
 {
-	glm::vec2 new_texture_coord = glm::vec2(std::stof(words[1]), std::stof(words[2]));
-	vt.push_back(new_texture_coord);
+	const std::string_view keyword = words[0];
+
+	if (keyword == "v")
+		ReadVertexData(chunk, words);
+	else if (keyword == "vt")
+		ReadTextureCoordData(chunk, words);
+	else if (keyword == "vn")
+		ReadNormalData(chunk, words);
+	else if (keyword == "f")
+		ReadFaceData(chunk, words);
+	else if (keyword == "usemtl" && words.size() > 1)
+		chunk.AddString(Chunk::RecordType::UseMaterial, std::string(words[1]));
+	else if (keyword == "mtllib" && words.size() > 1)
+		chunk.AddString(Chunk::RecordType::MaterialLibrary, std::string(words[1]));
 }
 
-void ObjLoader::ReadNormalData(const std::vector<std::string>& words)
+void ObjLoader::ReadVertexData(Chunk& chunk, const Words& words) const
 {
-	glm::vec4 new_normal		 = glm::vec4(std::stof(words[1]), std::stof(words[2]), std::stof(words[3]), 0.0f);
-	glm::vec3 transformed_normal = pre_transform * new_normal;
-	vn.push_back(transformed_normal);
+	float xyz[3];
+	if (!ParseFloats(words, 3, xyz))
+	{
+		chunk.AddString(Chunk::RecordType::Error, "Invalid vertex record");
+		return;
+	}
+
+	glm::vec4 new_vertex		 = glm::vec4(xyz[0], xyz[1], xyz[2], 1.0f);
+	glm::vec3 transformed_vertex = pre_transform * new_vertex;
+	chunk.v.push_back(transformed_vertex);
 }
 
-void ObjLoader::ReadFaceData(const std::vector<std::string>& words)
+void ObjLoader::ReadTextureCoordData(Chunk& chunk, const Words& words) const
 {
-	size_t triangle_count = words.size() - 3;
+	float uv[2];
+	if (!ParseFloats(words, 2, uv))
+	{
+		chunk.AddString(Chunk::RecordType::Error, "Invalid texture coordinate record");
+		return;
+	}
 
-	for (size_t i = 0; i < triangle_count; ++i)
+	glm::vec2 new_texture_coord = glm::vec2(uv[0], uv[1]);
+	chunk.vt.push_back(new_texture_coord);
+}
+
+void ObjLoader::ReadNormalData(Chunk& chunk, const Words& words) const
+{
+	float xyz[3];
+	if (!ParseFloats(words, 3, xyz))
 	{
-		ReadCorner(words.at(1));
-		ReadCorner(words.at(i + 2));
-		ReadCorner(words.at(i + 3));
+		chunk.AddString(Chunk::RecordType::Error, "Invalid normal record");
+		return;
 	}
+
+	glm::vec4 new_normal		 = glm::vec4(xyz[0], xyz[1], xyz[2], 0.0f);
+	glm::vec3 transformed_normal = pre_transform * new_normal;
+	chunk.vn.push_back(transformed_normal);
 }
 
-void ObjLoader::ReadCorner(const std::string& vertex_description)
+void ObjLoader::ReadFaceData(Chunk& chunk, const Words& words) const
 {
-	if (index_history.contains(vertex_description))
+	if (words.size() < 4)
 	{
-		indices->push_back(index_history[vertex_description]);
+		chunk.AddString(Chunk::RecordType::Error, "Face record needs at least three corners");
 		return;
 	}
 
-	uint32_t index = static_cast<uint32_t>(index_history.size());
-	index_history.insert({ vertex_description, index });
-	indices->push_back(index);
+	size_t first_corner = chunk.corners.size();
+	for (size_t i = 1; i < words.size(); ++i)
+	{
+		// Split "v/vt/vn" in place; "v", "v/vt" and "v//vn" are all valid
+		std::string_view  description = words[i];
+		std::string_view  v_vt_vn[3];
+		string::Tokenizer parts(description, "/");
+		size_t			  part_count = 0;
+		while (part_count < 3 && parts.Next(v_vt_vn[part_count]))
+			++part_count;
+
+		Corner corner;
+		if (!ParseIndex(v_vt_vn[0], corner.v) || (!v_vt_vn[1].empty() && !ParseIndex(v_vt_vn[1], corner.vt))
+			|| (!v_vt_vn[2].empty() && !ParseIndex(v_vt_vn[2], corner.vn)))
+		{
+			chunk.corners.resize(first_corner);
+			chunk.AddString(Chunk::RecordType::Error, "Invalid vertex description: " + std::string(description));
+			return;
+		}
+		chunk.corners.push_back(corner);
+	}
 
-	std::vector<std::string> v_vt_vn  = string::split(vertex_description, "/");
+	chunk.AddRecord(Chunk::RecordType::Face, uint32_t(words.size() - 1));
+}
 
-	if (v_vt_vn.size() < 1 || v_vt_vn[0].empty())
+void ObjLoader::MergeChunk(const std::string& file_dir, Chunk& chunk)
+{
+	size_t v_base  = v.size();
+	size_t vt_base = vt.size();
+	size_t vn_base = vn.size();
+	v.insert(v.end(), chunk.v.begin(), chunk.v.end());
+	vt.insert(vt.end(), chunk.vt.begin(), chunk.vt.end());
+	vn.insert(vn.end(), chunk.vn.begin(), chunk.vn.end());
+
+	// Every new vertex comes from a corner, so the chunk's corner count bounds the table growth
+	size_t triangle_corners = 0;
+	for (const Chunk::Record& record : chunk.records)
+		if (record.type == Chunk::RecordType::Face)
+			triangle_corners += (record.count - 2) * 3;
+	if (!sink)
 	{
-		NFT_ERROR(FileError, "Invalid vertex description: " + vertex_description);
-		return;
+		index_history.Reserve(index_history.GetSize() + chunk.corners.size());
+		indices->reserve(indices->size() + triangle_corners);
 	}
 
-	long vertex_index = std::stol(v_vt_vn[0]);
-	if (vertex_index <= 0 || static_cast<size_t>(vertex_index - 1) >= v.size())
+	std::vector<Corner> face;
+	size_t				corner_offset = 0;
+
+	for (const Chunk::Record& record : chunk.records)
 	{
-		NFT_ERROR(FileError, "Vertex index out of range: " + std::to_string(vertex_index));
-		return;
+		switch (record.type)
+		{
+		case Chunk::RecordType::Face:
+		{
+			// Resolve against the attribute counts at the point the face was read, as a serial parse would
+			face.clear();
+			bool valid = true;
+			for (uint32_t i = 0; i < record.count; ++i)
+			{
+				const Corner& raw = chunk.corners[corner_offset + i];
+
+				Corner resolved;
+				resolved.v	= ResolveIndex(raw.v, v_base + record.v_count);
+				resolved.vt = raw.vt ? ResolveIndex(raw.vt, vt_base + record.vt_count) : 0;
+				resolved.vn = raw.vn ? ResolveIndex(raw.vn, vn_base + record.vn_count) : 0;
+				if (!resolved.v || (raw.vt && !resolved.vt) || (raw.vn && !resolved.vn))
+				{
+					NFT_ERROR(ParseError, "Face index out of range: " + std::to_string(raw.v) + "/" + std::to_string(raw.vt) + "/" + std::to_string(raw.vn));
+					valid = false;
+					break;
+				}
+				face.push_back(resolved);
+			}
+			corner_offset += record.count;
+
+			if (!valid)
+				break;
+
+			size_t triangle_count = face.size() - 2;
+			if (material_ranges.empty() || material_ranges.back().material_id != material_id)
+				material_ranges.push_back({ uint32_t(indices->size()), 0, material_id });
+
+			for (size_t i = 0; i < triangle_count; ++i)
+			{
+				// A triangle adds at most three vertices; flush first so it lands whole in the next chunk
+				if (sink && index_history.GetSize() + 3 > max_chunk_vertices)
+				{
+					FlushChunk();
+					material_ranges.push_back({ 0, 0, material_id });
+				}
+				material_ranges.back().index_count += 3;
+
+				ReadCorner(face[0]);
+				ReadCorner(face[i + 1]);
+				ReadCorner(face[i + 2]);
+			}
+			break;
+		}
+		case Chunk::RecordType::UseMaterial:
+		{
+			const std::string& material_name = chunk.strings[record.count];
+			material_id						 = material_ids.try_emplace(material_name, uint32_t(material_ids.size() + 1)).first->second;
+
+			auto color = colors.find(material_name);
+			if (color != colors.end())
+				brush_color = color->second;	// Use the color from the material
+			else
+				brush_color = glm::vec3(1.0);	 // Unknown material, fall back to white
+			break;
+		}
+		case Chunk::RecordType::MaterialLibrary: ParseMtlFile(file_dir, chunk.strings[record.count]); break;
+		case Chunk::RecordType::Error: NFT_ERROR(ParseError, chunk.strings[record.count]); break;
+		}
 	}
-	
+}
+
+void ObjLoader::ReadCorner(const Corner& corner)
+{
+	CornerKey key;
+	key.position_texcoord = uint64_t(uint32_t(corner.v)) | uint64_t(uint32_t(corner.vt)) << 32;
+	key.normal_material	  = uint64_t(uint32_t(corner.vn)) | uint64_t(material_id) << 32;
+
+	auto [index, inserted] = index_history.FindOrInsert(key, static_cast<uint32_t>(index_history.GetSize()));
+	indices->push_back(index);
+	if (!inserted)
+		return;
+
 	// Position
-	glm::vec3				 position = v.at(std::stol(v_vt_vn[0]) - 1);
+	glm::vec3				 position = v[corner.v - 1];
 	vertices->push_back(position.x);
 	vertices->push_back(position.y);
 	vertices->push_back(position.z);
@@ -179,17 +570,38 @@ void ObjLoader::ReadCorner(const std::string& vertex_description)
 
 	// Texture Coordinate
 	glm::vec2 texture_coord = glm::vec2(0.0f, 0.0f);
-	if (v_vt_vn.size() == 3 && !v_vt_vn[1].empty())
-		texture_coord = vt.at(std::stol(v_vt_vn[1]) - 1);
+	if (corner.vt)
+		texture_coord = vt[corner.vt - 1];
 	vertices->push_back(texture_coord.x);
 	vertices->push_back(texture_coord.y);
 
 	// Normal
-	glm::vec3				 normal = v.at(std::stol(v_vt_vn[2]) - 1);
+	glm::vec3				 normal = glm::vec3(0.0f);
+	if (corner.vn)
+		normal = vn[corner.vn - 1];
 	vertices->push_back(normal.x);
 	vertices->push_back(normal.y);
 	vertices->push_back(normal.z);
 
 }
 
+void ObjLoader::FlushChunk()
+{
+	if (!sink || indices->empty())
+		return;
+
+	std::erase_if(material_ranges, [](const MaterialRange& range) { return range.index_count == 0; });
+
+	MeshChunk chunk;
+	chunk.vertices		  = *vertices;
+	chunk.indices		  = *indices;
+	chunk.material_ranges = material_ranges;
+	sink(chunk);
+
+	vertices->clear();
+	indices->clear();
+	material_ranges.clear();
+	index_history.Clear();
+}
+
 }	 // namespace nft::parse
@@ -1,20 +1,254 @@
 #include "core/string.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define NFT_STRING_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NFT_STRING_SSE2 1
+#include <emmintrin.h>
+#endif
+
 namespace nft::string
 {
-std::vector<std::string> split(std::string string, std::string delimiter)
+namespace
+{
+bool IsWhitespace(char c)
+{
+	return c == ' ' || static_cast<unsigned char>(c - '\t') <= '\r' - '\t';
+}
+
+// Matchers give a bit per byte of a block that matches, lowest address first
+struct CharMatcher
+{
+	char c;
+
+	bool Test(char value) const { return value == c; }
+#if NFT_STRING_SSE2
+	uint32_t Mask(__m128i block) const { return _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c))); }
+#endif
+#if NFT_STRING_AVX2
+	uint32_t Mask(__m256i block) const { return _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(c))); }
+#endif
+};
+
+template<bool match>
+struct WhitespaceMatcher
+{
+	bool Test(char value) const { return IsWhitespace(value) == match; }
+#if NFT_STRING_SSE2
+	uint32_t Mask(__m128i block) const
+	{
+		// '\t' to '\r' are contiguous: after subtracting '\t' they are exactly the bytes with min(byte, 4) == byte
+		__m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+		__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+		uint32_t mask	= _mm_movemask_epi8(_mm_or_si128(control, _mm_cmpeq_epi8(block, _mm_set1_epi8(' '))));
+		return match ? mask : ~mask & 0xFFFFu;
+	}
+#endif
+#if NFT_STRING_AVX2
+	uint32_t Mask(__m256i block) const
+	{
+		__m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+		__m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted);
+		uint32_t mask	= _mm256_movemask_epi8(_mm256_or_si256(control, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '))));
+		return match ? mask : ~mask;
+	}
+#endif
+};
+
+#if NFT_STRING_AVX2
+constexpr size_t block_size = 32;
+#elif NFT_STRING_SSE2
+constexpr size_t block_size = 16;
+#endif
+
+#if NFT_STRING_SSE2
+constexpr uint32_t block_bits = block_size == 32 ? ~0u : (1u << block_size) - 1;
+
+// Bit per byte of a block_size block that the matcher accepts
+template<typename Matcher>
+uint32_t BlockMask(const char* block, const Matcher& matcher)
+{
+#if NFT_STRING_AVX2
+	return matcher.Mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(block)));
+#else
+	return matcher.Mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)));
+#endif
+}
+#endif
+
+// First position at or after pos whose byte the matcher accepts, widest blocks first
+template<typename Matcher>
+size_t Scan(std::string_view text, size_t pos, const Matcher& matcher)
+{
+	const char* data = text.data();
+	size_t		size = text.size();
+
+#if NFT_STRING_AVX2
+	for (; pos + 32 <= size; pos += 32)
+	{
+		uint32_t mask = matcher.Mask(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos)));
+		if (mask != 0)
+			return pos + std::countr_zero(mask);
+	}
+#endif
+#if NFT_STRING_SSE2
+	for (; pos + 16 <= size; pos += 16)
+	{
+		uint32_t mask = matcher.Mask(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+		if (mask != 0)
+			return pos + std::countr_zero(mask);
+	}
+#endif
+	for (; pos < size; ++pos)
+		if (matcher.Test(data[pos]))
+			return pos;
+	return std::string_view::npos;
+}
+}	 // namespace
+
+std::vector<std::string> split(std::string_view string, std::string_view delimiter)
 {
 	std::vector<std::string> split_str;
+	Tokenizer				 tokenizer(string, delimiter);
+	for (std::string_view token : tokenizer)
+		split_str.emplace_back(token);
+	return split_str;
+}
 
+size_t FindChar(std::string_view text, char c, size_t pos)
+{
+#if NFT_STRING_SSE2
+	return Scan(text, pos, CharMatcher { c });
+#else
+	// The C library's memchr is usually vectorized for the target already
+	if (pos >= text.size())
+		return std::string_view::npos;
+	const void* found = std::memchr(text.data() + pos, c, text.size() - pos);
+	return found ? static_cast<const char*>(found) - text.data() : std::string_view::npos;
+#endif
+}
+
+size_t Find(std::string_view text, std::string_view delimiter, size_t pos)
+{
+	if (delimiter.size() <= 1)
+		return delimiter.empty() ? (pos <= text.size() ? pos : std::string_view::npos) : FindChar(text, delimiter[0], pos);
+
+	// Vector scan for the first character, then compare the rest
+	size_t last = text.size() >= delimiter.size() ? text.size() - delimiter.size() : 0;
+	while (pos <= last && text.size() >= delimiter.size())
+	{
+		pos = FindChar(text.substr(0, last + 1), delimiter[0], pos);
+		if (pos == std::string_view::npos)
+			break;
+		if (std::memcmp(text.data() + pos + 1, delimiter.data() + 1, delimiter.size() - 1) == 0)
+			return pos;
+		++pos;
+	}
+	return std::string_view::npos;
+}
+
+size_t FindWhitespace(std::string_view text, size_t pos)
+{
+	return Scan(text, pos, WhitespaceMatcher<true>());
+}
+
+size_t FindNotWhitespace(std::string_view text, size_t pos)
+{
+	return Scan(text, pos, WhitespaceMatcher<false>());
+}
+
+void SplitWhitespace(std::string_view text, std::vector<std::string_view>& tokens)
+{
+	tokens.clear();
+
+#if NFT_STRING_SSE2
+	// Words are usually shorter than a block, so instead of scanning for each boundary, every block is
+	// classified once and the word starts and ends are read off the bits where the class changes
+	const char* data	 = text.data();
+	size_t		size	 = text.size();
+	size_t		start	 = 0;
+	bool		in_token = false;
+	for (size_t base = 0; base < size; base += block_size)
+	{
+		uint32_t word_mask;
+		if (size - base >= block_size)
+			word_mask = BlockMask(data + base, WhitespaceMatcher<false>());
+		else
+		{
+			char tail[block_size];
+			std::memset(tail, ' ', block_size);
+			std::memcpy(tail, data + base, size - base);
+			word_mask = BlockMask(tail, WhitespaceMatcher<false>());
+		}
+
+		uint32_t edges = (word_mask ^ ((word_mask << 1) | (in_token ? 1u : 0u))) & block_bits;
+		for (; edges != 0; edges &= edges - 1)
+		{
+			size_t position = base + std::countr_zero(edges);
+			if (in_token)
+				tokens.emplace_back(data + start, position - start);
+			else
+				start = position;
+			in_token = !in_token;
+		}
+	}
+	if (in_token)
+		tokens.emplace_back(data + start, size - start);
+#else
 	size_t pos = 0;
-	std::string token;
-	while ((pos = string.find(delimiter)) != std::string::npos)
+	while (pos < text.size())
 	{
-		token = string.substr(0, pos);
-		split_str.push_back(token);
-		string.erase(0, pos + delimiter.length());
+		while (pos < text.size() && IsWhitespace(text[pos]))
+			++pos;
+		size_t start = pos;
+		while (pos < text.size() && !IsWhitespace(text[pos]))
+			++pos;
+		if (pos > start)
+			tokens.push_back(text.substr(start, pos - start));
 	}
-	split_str.push_back(string);	// Add the last token after the last delimiter
-	return split_str;
+#endif
+}
+
+bool Tokenizer::Next(std::string_view& token)
+{
+	if (whitespace)
+	{
+		size_t start = FindNotWhitespace(text, pos);
+		if (start == std::string_view::npos)
+		{
+			pos = text.size();
+			return false;
+		}
+		size_t end = std::min(FindWhitespace(text, start), text.size());
+		token	   = text.substr(start, end - start);
+		pos		   = end;
+		return true;
+	}
+
+	while (!finished)
+	{
+		size_t end = delimiter.empty() ? std::string_view::npos : Find(text, delimiter, pos);
+		if (end == std::string_view::npos)
+		{
+			token	 = text.substr(pos);
+			finished = true;
+		}
+		else
+		{
+			token = text.substr(pos, end - pos);
+			pos	  = end + delimiter.size();
+		}
+
+		if (!collapse || !token.empty())
+			return true;
+	}
+	return false;
 }
-}	 // namespace nft::tring
\ No newline at end of file
+}	 // namespace nft::string
@@ -5,26 +5,33 @@ layout (location = 0) in vec4 frag_color;
 layout (location = 1) in vec2 frag_texture_coord;
 layout (location = 2) in vec3 frag_world_pos;
 layout (location = 3) in vec3 frag_normal;
+layout (location = 4) flat in uint frag_material_index;
 
 layout (location = 0) out vec4 out_color;
 
 // Set 1: Texture array for all textures
 layout (set = 1, binding = 0) uniform sampler2D textures[32]; // Array of textures
 
-// Push constants for per-object material properties
-layout (push_constant) uniform MaterialPushConstants {
+struct Material {
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     float specular_highlights;
     uint diffuse_texture_index;     // Index into texture array
-    uint ambient_texture_index;     // Index into texture array  
+    uint ambient_texture_index;     // Index into texture array
     uint specular_texture_index;    // Index into texture array
     uint padding;
-} material;
+};
 
-void main() {
+// All materials of the scene, then the default material
+layout (std430, set = 0, binding = 3) readonly buffer MaterialBuffer {
+    Material materials[];
+} Materials;
 
+void main() {
+    // Instanced draws never mix materials (Surface::WriteInstances), so the texture indices below are
+    // dynamically uniform and need no nonuniformEXT
+    Material material = Materials.materials[frag_material_index];
     
     vec3 diffuse_color = material.diffuse;
     if (material.diffuse_texture_index < 32) {
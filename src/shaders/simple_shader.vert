@@ -11,6 +11,15 @@ layout (std140, set = 0, binding = 1) readonly buffer StorageBuffer {
 	mat4 transforms[];
 } ObjectData;
 
+// Material of each instance
+layout (std430, set = 0, binding = 2) readonly buffer ObjectMaterialBuffer {
+	uint indices[];
+} ObjectMaterials;
+
+// Set for VertexFormat::Compact: positions are unorm in the mesh bounds (the object transform maps them back)
+// and normals arrive octahedral encoded in xy
+layout (constant_id = 0) const bool compact_vertices = false;
+
 layout (location = 0) in vec3 vertex_position;
 layout (location = 1) in vec4 vertex_color;
 layout (location = 2) in vec2 vertex_texture_coord;
@@ -20,6 +29,14 @@ layout (location = 0) out vec4 frag_color;
 layout (location = 1) out vec2 frag_texture_coord;
 layout (location = 2) out vec3 frag_world_pos;
 layout (location = 3) out vec3 frag_normal;
+layout (location = 4) flat out uint frag_material_index;
+
+vec3 oct_decode(vec2 encoded) {
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (normal.z < 0.0)
+		normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(normal);
+}
 
 void main() {
 	vec3 debug_colors[4] = vec3[4](
@@ -38,5 +55,6 @@ void main() {
 	frag_world_pos = world_pos.xyz;
 	
 	// For now, assume normal is just up vector (you can enhance this later)
-	frag_normal = vertex_normal;
+	frag_normal = compact_vertices ? oct_decode(vertex_normal.xy) : vertex_normal;
+	frag_material_index = ObjectMaterials.indices[gl_InstanceIndex];
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "vk/asset_loader.h"
+
+#include "vk/handler.h"
+
+#include <algorithm>
+
+namespace nft::vulkan
+{
+
+AssetLoader::AssetLoader(uint32_t worker_count)
+{
+	if (worker_count == 0)
+		// Leaves a core for the render thread; hardware_concurrency is 0 when it can't tell
+		worker_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	workers.reserve(worker_count);
+	for (uint32_t i = 0; i < worker_count; i++)
+		workers.emplace_back(&AssetLoader::WorkerLoop, this);
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	job_available.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+template<typename T>
+AssetHandle<T> AssetLoader::Submit(std::function<std::shared_ptr<T>()> load, ReadyCallback<T> on_ready)
+{
+	auto		   promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+	AssetHandle<T> handle  = promise->get_future().share();
+
+	auto job = [this, load = std::move(load), on_ready = std::move(on_ready), promise]()
+	{
+		std::shared_ptr<T> asset = load();
+		promise->set_value(asset);
+
+		std::lock_guard lock(mutex);
+		pending--;
+		if (on_ready && asset)
+			completed.push_back([on_ready, asset]() { on_ready(asset); });
+	};
+
+	{
+		std::lock_guard lock(mutex);
+		jobs.push_back(std::move(job));
+		pending++;
+	}
+	job_available.notify_one();
+	return handle;
+}
+
+AssetHandle<IMesh> AssetLoader::LoadMesh(const std::string&			  file_dir,
+										 const std::string&			  file_name,
+										 const MeshOptimizer::Options& optimize_options,
+										 ReadyCallback<IMesh>		  on_ready)
+{
+	return Submit<IMesh>(
+		[file_dir, file_name, optimize_options]() -> std::shared_ptr<IMesh>
+		{
+			auto mesh = std::make_shared<SimpleMesh>();
+			mesh->LoadObj(file_dir, file_name, optimize_options);
+			if (mesh->GetVertexData().empty())
+				return nullptr;
+			return mesh;
+		},
+		std::move(on_ready));
+}
+
+AssetHandle<TextureData> AssetLoader::LoadTexture(const std::string& file_path, ReadyCallback<TextureData> on_ready)
+{
+	return Submit<TextureData>(
+		[file_path]() -> std::shared_ptr<TextureData>
+		{
+			TextureData data = Texture::Decode(file_path);
+			if (!data.IsValid())
+			{
+				VulkanHandler::app->GetLogger()->Warn(std::format("Failed to decode \"{}\"", file_path), "VKInit");
+				return nullptr;
+			}
+			return std::make_shared<TextureData>(std::move(data));
+		},
+		std::move(on_ready));
+}
+
+size_t AssetLoader::ProcessCompleted(size_t max_count)
+{
+	size_t processed = 0;
+	while (processed < max_count)
+	{
+		std::function<void()> callback;
+		{
+			std::lock_guard lock(mutex);
+			if (completed.empty())
+				break;
+			callback = std::move(completed.front());
+			completed.pop_front();
+		}
+
+		// Outside the lock, so callbacks may queue further loads
+		callback();
+		processed++;
+	}
+	return processed;
+}
+
+bool AssetLoader::HasCompleted() const
+{
+	std::lock_guard lock(mutex);
+	return !completed.empty();
+}
+
+size_t AssetLoader::GetPendingCount() const
+{
+	std::lock_guard lock(mutex);
+	return pending;
+}
+
+void AssetLoader::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock lock(mutex);
+			job_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+}	 // namespace nft::vulkan
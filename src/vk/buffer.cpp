@@ -1,11 +1,12 @@
 #include "vk/buffer.h"
 
 #include "vk/commands.h"
+#include "vk/deletion_queue.h"
 #include "vk/handler.h"
 
 namespace nft::vulkan
 {
-BufferManager::BufferManager(Device* device): device(device)
+BufferManager::BufferManager(Device* device): device(device), allocator(device)
 {
 	if (!device)
 		NFT_ERROR(VulkanFatal, "Device pointer is null in BufferManager constructor.");
@@ -13,43 +14,41 @@ BufferManager::BufferManager(Device* device): device(device)
 
 BufferManager::~BufferManager()
 {
-	// Clear all buffers - let unique_ptr destructors handle cleanup
-	for (auto& buffer : managed_buffers)
-	{
-		if (buffer && buffer->vk_buffer != VK_NULL_HANDLE)
-		{
-			try
-			{
-				// Check memory handle validity before freeing
-				if (buffer->vk_memory != VK_NULL_HANDLE)
-				{
-					device->GetDevice().freeMemory(buffer->vk_memory);
-					buffer->vk_memory = VK_NULL_HANDLE;
-				}
-				device->GetDevice().destroyBuffer(buffer->vk_buffer);
-				buffer->vk_buffer = VK_NULL_HANDLE;
-			}
-			catch (const vk::SystemError& err)
-			{
-				NFT_ERROR(VulkanFatal, std::format("Failed To Destroy Buffer:\n{}", err.what()));
-			}
-		}
-	}
-	// Clear the vector after manual cleanup
-	managed_buffers.clear();
+	// Slots are destroyed with the manager, only the Vulkan resources need releasing
+	for (Slot& slot : slots)
+		if (slot.alive)
+			ReleaseBuffer(slot.buffer);
+	slots.clear();
 }
 
-Buffer* BufferManager::CreateBuffer(size_t size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties)
+BufferHandle BufferManager::CreateBuffer(size_t					size,
+										 vk::BufferUsageFlags		usage,
+										 vk::MemoryPropertyFlags	properties,
+										 bool						shared_with_uploads)
 {
-	// Create buffer on the heap to ensure proper initialization
-	auto buffer = std::make_unique<Buffer>();
-	
-	// Ensure all handles are properly initialized to VK_NULL_HANDLE
-	buffer->vk_buffer = VK_NULL_HANDLE;
-	buffer->vk_memory = VK_NULL_HANDLE;
-	
+	// Reuse a dead slot if there is one; the generation it kept tells its old handles apart
+	uint32_t index;
+	if (free_slots != BufferHandle::invalid)
+	{
+		index	   = free_slots;
+		free_slots = slots[index].next_free;
+	}
+	else
+	{
+		index = static_cast<uint32_t>(slots.size());
+		slots.emplace_back();
+	}
+	Slot& slot	   = slots[index];
+	slot.buffer	   = Buffer();
+	Buffer* buffer = &slot.buffer;
+
 	buffer->vk_buffer_info = vk::BufferCreateInfo().setSize(size).setUsage(usage).setSharingMode(vk::SharingMode::eExclusive);
 
+	const QueueFamilyIndices& indices = device->GetQueueFamilyIndices();
+	std::array<uint32_t, 2>	  families{ indices.graphics_family.value(), indices.transfer_family.value() };
+	if (shared_with_uploads && device->HasDedicatedTransferQueue())
+		buffer->vk_buffer_info.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(families);
+
 	try
 	{
 		buffer->vk_buffer = device->GetDevice().createBuffer(buffer->vk_buffer_info);
@@ -66,33 +65,21 @@ Buffer* BufferManager::CreateBuffer(size_t size, vk::BufferUsageFlags usage, vk:
 	buffer->vk_memory_info =
 		vk::MemoryAllocateInfo().setAllocationSize(memory_requirements.size).setMemoryTypeIndex(memory_type_index);
 
+	// A range of a shared memory block, not an allocation of its own
+	buffer->allocation	  = allocator.Allocate(memory_requirements, memory_type_index, true);
+	buffer->vk_memory	  = buffer->allocation.memory;
+	buffer->memory_offset = buffer->allocation.offset;
+	buffer->mapped		  = buffer->allocation.mapped;
+
 	try
 	{
-		buffer->vk_memory = device->GetDevice().allocateMemory(buffer->vk_memory_info);
-	}
-	catch (const vk::SystemError& err)
-	{
-		// If memory allocation fails, clean up the buffer first
-		if (buffer->vk_buffer != VK_NULL_HANDLE)
-		{
-			device->GetDevice().destroyBuffer(buffer->vk_buffer);
-			buffer->vk_buffer = VK_NULL_HANDLE;
-		}
-		NFT_ERROR(VulkanFatal, std::format("Failed To Allocate Buffer Memory:\n{}", err.what()));
-	}
-	
-	try
-	{
-		device->GetDevice().bindBufferMemory(buffer->vk_buffer, buffer->vk_memory, 0);
+		device->GetDevice().bindBufferMemory(buffer->vk_buffer, buffer->vk_memory, buffer->memory_offset);
 	}
 	catch (const vk::SystemError& err)
 	{
 		// Clean up both buffer and memory if binding fails
-		if (buffer->vk_memory != VK_NULL_HANDLE)
-		{
-			device->GetDevice().freeMemory(buffer->vk_memory);
-			buffer->vk_memory = VK_NULL_HANDLE;
-		}
+		allocator.Free(buffer->allocation);
+		buffer->vk_memory = VK_NULL_HANDLE;
 		if (buffer->vk_buffer != VK_NULL_HANDLE)
 		{
 			device->GetDevice().destroyBuffer(buffer->vk_buffer);
@@ -101,62 +88,102 @@ Buffer* BufferManager::CreateBuffer(size_t size, vk::BufferUsageFlags usage, vk:
 		NFT_ERROR(VulkanFatal, std::format("Failed To Bind Buffer Memory:\n{}", err.what()));
 	}
 
-	Buffer* buffer_ptr = buffer.get();
-	managed_buffers.push_back(std::move(buffer));
-	return buffer_ptr;
+	slot.alive = true;
+	return { index, slot.generation };
 }
 
-void BufferManager::DestroyBuffer(Buffer* buffer)
+void BufferManager::DestroyBuffer(BufferHandle handle)
 {
-	if (!buffer)
+	if (!handle)
 		return;
+	if (!IsAlive(handle))
+	{
+#ifdef _DEBUG
+		NFT_ERROR(VulkanFatal, std::format("Destroying stale buffer handle (slot {}, generation {}).", handle.index, handle.generation));
+#endif
+		return;
+	}
 
-	auto it = std::find_if(managed_buffers.begin(),
-						   managed_buffers.end(),
-						   [buffer](const std::unique_ptr<Buffer>& managed_buffer) { return managed_buffer.get() == buffer; });
+	// The handle goes stale now; the Vulkan buffer and its memory once frames and uploads in flight are done
+	Slot& slot = slots[handle.index];
+	device->GetDeletionQueue()->Push([this, buffer = slot.buffer]() mutable { ReleaseBuffer(buffer); });
+	slot.buffer	   = Buffer();
+	slot.alive	   = false;
+	slot.generation++;
+	slot.next_free = free_slots;
+	free_slots	   = handle.index;
+}
+
+Buffer* BufferManager::Get(BufferHandle handle)
+{
+	if (!handle)
+		return nullptr;
+#ifdef _DEBUG
+	if (!IsAlive(handle))
+		NFT_ERROR(VulkanFatal, std::format("Stale buffer handle (slot {}, generation {}).", handle.index, handle.generation));
+#endif
+	return &slots[handle.index].buffer;
+}
+
+bool BufferManager::IsAlive(BufferHandle handle) const
+{
+	return handle.index < slots.size() && slots[handle.index].alive && slots[handle.index].generation == handle.generation;
+}
 
-	if (it != managed_buffers.end())
+void BufferManager::ReleaseBuffer(Buffer& buffer)
+{
+	try
 	{
-		try
-		{
-			// Clean up Vulkan resources - check handles are valid before destroying
-			if ((*it)->vk_memory != VK_NULL_HANDLE)
-			{
-				device->GetDevice().freeMemory((*it)->vk_memory);
-				(*it)->vk_memory = VK_NULL_HANDLE;
-			}
-			if ((*it)->vk_buffer != VK_NULL_HANDLE)
-			{
-				device->GetDevice().destroyBuffer((*it)->vk_buffer);
-				(*it)->vk_buffer = VK_NULL_HANDLE;
-			}
-		}
-		catch (const vk::SystemError& err)
+		// Clean up Vulkan resources - check handles are valid before destroying
+		if (buffer.vk_buffer != VK_NULL_HANDLE)
 		{
-			NFT_ERROR(VulkanFatal, std::format("Failed To Destroy Buffer:\n{}", err.what()));
+			device->GetDevice().destroyBuffer(buffer.vk_buffer);
+			buffer.vk_buffer = VK_NULL_HANDLE;
 		}
-
-		// Remove from managed buffers
-		managed_buffers.erase(it);
+		allocator.Free(buffer.allocation);
+		buffer.vk_memory = VK_NULL_HANDLE;
+		buffer.mapped	 = nullptr;
+	}
+	catch (const vk::SystemError& err)
+	{
+		NFT_ERROR(VulkanFatal, std::format("Failed To Destroy Buffer:\n{}", err.what()));
 	}
 }
 
-void BufferManager::CopyBuffer(Buffer*			 src_buffer,
-							   Buffer*			 dst_buffer,
-							   size_t			 size,
-							   vk::CommandBuffer command_buffer,
-							   vk::Queue		 queue)
+void BufferManager::CopyBuffer(BufferHandle			   src_handle,
+							   BufferHandle			   dst_handle,
+							   size_t				   size,
+							   vk::CommandBuffer	   command_buffer,
+							   vk::Queue			   queue,
+							   commands::CommandBatch* batch)
 {
-	if (!src_buffer || !dst_buffer || !src_buffer->vk_buffer || !dst_buffer->vk_buffer)
-		NFT_ERROR(VulkanFatal, "Invalid buffer pointers in CopyBuffer");
-
-	commands::StartJob(command_buffer, vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
 	vk::BufferCopy copy_region = vk::BufferCopy().setSize(size);
+	CopyBuffer(src_handle, dst_handle, std::span(&copy_region, 1), command_buffer, queue, batch);
+}
 
-	command_buffer.copyBuffer(src_buffer->vk_buffer, dst_buffer->vk_buffer, 1, &copy_region);
+void BufferManager::CopyBuffer(BufferHandle					   src_handle,
+							   BufferHandle					   dst_handle,
+							   std::span<const vk::BufferCopy> regions,
+							   vk::CommandBuffer			   command_buffer,
+							   vk::Queue					   queue,
+							   commands::CommandBatch*		   batch)
+{
+	Buffer* src_buffer = Get(src_handle);
+	Buffer* dst_buffer = Get(dst_handle);
+	if (!src_buffer || !dst_buffer || !src_buffer->vk_buffer || !dst_buffer->vk_buffer)
+		NFT_ERROR(VulkanFatal, "Invalid buffer pointers in CopyBuffer");
+	if (regions.empty())
+		return;
 
-	commands::EndJob(command_buffer, queue);
+	// All regions go in one submission, or in the caller's batch
+	if (batch)
+		batch->CopyBuffer(src_buffer->vk_buffer, dst_buffer->vk_buffer, regions);
+	else
+	{
+		commands::CommandBatch own_batch(device->GetDevice(), command_buffer, queue);
+		own_batch.CopyBuffer(src_buffer->vk_buffer, dst_buffer->vk_buffer, regions);
+		own_batch.Submit();
+	}
 }
 
 uint32_t BufferManager::FindMemoryType(uint32_t supported_memory_indices, vk::MemoryPropertyFlags requested_properties)
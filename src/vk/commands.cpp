@@ -19,19 +19,93 @@ void StartJob(vk::CommandBuffer command_buffer, vk::CommandBufferUsageFlags flag
 	}
 }
 
-void EndJob(vk::CommandBuffer command_buffer, vk::Queue queue)
+CommandBatch::CommandBatch(vk::Device device, vk::CommandBuffer command_buffer, vk::Queue queue):
+	device(device), command_buffer(command_buffer), queue(queue)
 {
-	command_buffer.end();
-	vk::SubmitInfo submit_info = vk::SubmitInfo().setCommandBufferCount(1).setPCommandBuffers(&command_buffer);
+	StartJob(command_buffer, vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+}
+
+CommandBatch::~CommandBatch()
+{
+#ifdef _DEBUG
+	if (open)
+		NFT_ERROR(VulkanFatal, "Command batch destroyed without being submitted!");
+#endif
+}
+
+void CommandBatch::Barrier(vk::PipelineStageFlags src_stage, vk::PipelineStageFlags dst_stage, const vk::ImageMemoryBarrier& barrier)
+{
+	src_stages |= src_stage;
+	dst_stages |= dst_stage;
+	image_barriers.push_back(barrier);
+}
+
+void CommandBatch::Barrier(vk::PipelineStageFlags src_stage, vk::PipelineStageFlags dst_stage, const vk::BufferMemoryBarrier& barrier)
+{
+	src_stages |= src_stage;
+	dst_stages |= dst_stage;
+	buffer_barriers.push_back(barrier);
+}
+
+void CommandBatch::CopyBuffer(vk::Buffer src, vk::Buffer dst, std::span<const vk::BufferCopy> regions)
+{
+	if (!regions.empty())
+		Record().copyBuffer(src, dst, static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void CommandBatch::CopyBufferToImage(vk::Buffer							  src,
+									 vk::Image							  dst,
+									 vk::ImageLayout					  dst_layout,
+									 std::span<const vk::BufferImageCopy> regions)
+{
+	if (!regions.empty())
+		Record().copyBufferToImage(src, dst, dst_layout, static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+vk::CommandBuffer CommandBatch::Record()
+{
+	if (!open)
+		NFT_ERROR(VulkanFatal, "Command batch was already submitted!");
+	FlushBarriers();
+	return command_buffer;
+}
+
+void CommandBatch::Submit(vk::Fence fence)
+{
+	Record();
+	open = false;
+
+	vk::Fence wait_fence = fence;
 	try
 	{
-		queue.submit(1, &submit_info, nullptr);
+		if (!wait_fence)
+			wait_fence = device.createFence(vk::FenceCreateInfo());
+		command_buffer.end();
+		queue.submit(vk::SubmitInfo().setCommandBufferCount(1).setPCommandBuffers(&command_buffer), wait_fence);
 	}
 	catch (const vk::SystemError& err)
 	{
-		NFT_ERROR(VulkanFatal, std::format("Failed To Submit Command Buffer:\n{}", err.what()));
+		NFT_ERROR(VulkanFatal, std::format("Failed To Submit Command Batch:\n{}", err.what()));
 	}
-	queue.waitIdle();
+
+	// Only this submission is waited for, not everything else on the queue
+	vk::Result result = device.waitForFences(wait_fence, VK_TRUE, UINT64_MAX);
+	if (!fence)
+		device.destroyFence(wait_fence);
+	if (result != vk::Result::eSuccess)
+		NFT_ERROR(VulkanFatal, "Failed To Wait For Command Batch.");
+}
+
+void CommandBatch::FlushBarriers()
+{
+	if (image_barriers.empty() && buffer_barriers.empty())
+		return;
+
+	command_buffer.pipelineBarrier(src_stages, dst_stages, vk::DependencyFlags(), nullptr, buffer_barriers, image_barriers);
+	src_stages = vk::PipelineStageFlags();
+	dst_stages = vk::PipelineStageFlags();
+	image_barriers.clear();
+	buffer_barriers.clear();
 }
 
 }	 // namespace nft::vulkan::commands
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "vk/deletion_queue.h"
+
+#include "vk/handler.h"
+#include "vk/upload_scheduler.h"
+
+#include <algorithm>
+
+namespace nft::vulkan
+{
+
+DeletionQueue::DeletionQueue(Device* device): device(device)
+{
+	if (!device)
+		NFT_ERROR(VulkanFatal, "Device pointer is null in DeletionQueue constructor.");
+}
+
+DeletionQueue::~DeletionQueue()
+{
+	if (!entries.empty())
+	{
+		device->GetDevice().waitIdle();
+		Flush();
+	}
+}
+
+void DeletionQueue::Push(std::function<void()> destroy)
+{
+	UploadScheduler* uploads = device->GetUploadScheduler();
+	Entry			 entry	 = { submitted_frames, uploads ? uploads->GetSubmittedValue() : 0, std::move(destroy) };
+
+	// Nothing queued ahead of it and no GPU work that could still use it
+	if (entries.empty() && IsSafe(entry))
+	{
+		entry.destroy();
+		return;
+	}
+	entries.push_back(std::move(entry));
+}
+
+void DeletionQueue::RetireFrame(uint64_t serial)
+{
+	retired_frames = std::max(retired_frames, serial);
+	Collect();
+}
+
+void DeletionQueue::Flush()
+{
+	// Taken out first, so entries pushed while destroying don't change the queue under the loop
+	std::deque<Entry> flushed;
+	flushed.swap(entries);
+	for (Entry& entry : flushed)
+		entry.destroy();
+	retired_frames = submitted_frames;
+}
+
+bool DeletionQueue::IsSafe(const Entry& entry) const
+{
+	UploadScheduler* uploads = device->GetUploadScheduler();
+	return entry.frame <= retired_frames && (!uploads || uploads->IsComplete(entry.upload));
+}
+
+void DeletionQueue::Collect()
+{
+	while (!entries.empty() && IsSafe(entries.front()))
+	{
+		Entry entry = std::move(entries.front());
+		entries.pop_front();
+		entry.destroy();
+	}
+}
+
+}	 // namespace nft::vulkan
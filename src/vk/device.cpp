@@ -11,7 +11,11 @@
 
 #include "vk/handler.h"
 #include "vk/buffer.h"
+#include "vk/staging_ring.h"
+#include "vk/upload_scheduler.h"
+#include "vk/deletion_queue.h"
 
+#include <cstring>
 #include <set>
 #include "vulkan/vulkan_win32.h"
 
@@ -44,7 +48,10 @@ Device::Device(Instance* instance) : instance(instance)
     instance->InitDispatchLoaderWithDevice(vk_device);
 
     // Initialize buffer manager after device is created
-    buffer_manager = std::make_unique<BufferManager>(this);
+    buffer_manager   = std::make_unique<BufferManager>(this);
+    deletion_queue   = std::make_unique<DeletionQueue>(this);
+    staging_ring     = std::make_unique<StagingRing>(this);
+    upload_scheduler = std::make_unique<UploadScheduler>(this);
 }
 
 Device::~Device()
@@ -52,6 +59,10 @@ Device::~Device()
     app->GetLogger()->Debug("Cleaning Up Device...", "VKShutdown");
     
     // Clean up buffer manager before destroying device
+    upload_scheduler.reset();
+    staging_ring.reset();
+    // Releases what is still queued, which may include buffers and image memory
+    deletion_queue.reset();
     buffer_manager.reset();
     
     vk_device.destroy();
@@ -149,6 +160,7 @@ void Device::FindSuitableDevice()
         {
             app->GetLogger()->Debug(std::format("Device {} Is Suitable!", device_properties.deviceName.data()), "VKInit");
             vk_physical_device = physical_device;
+            device_properties  = physical_device.getProperties();    // Limits of the chosen device, not the last listed
             return;
         }
     }
@@ -163,6 +175,7 @@ void Device::FindQueueFamilies()
     // Reset queue family indices
     queue_family_indices.graphics_family = std::nullopt;
     queue_family_indices.present_family  = std::nullopt;
+    queue_family_indices.transfer_family = std::nullopt;
 
     // Get available queue families
     std::vector<vk::QueueFamilyProperties> queue_families =
@@ -213,6 +226,21 @@ void Device::FindQueueFamilies()
             queue_family_indices.present_family = queue_family_indices.graphics_family;
         }
     }
+
+    // Uploads get their own queue when a family does transfers only, usually backed by a DMA engine that copies
+    // while the graphics queue renders. Failing that, one without graphics; failing that, the graphics queue.
+    for (uint32_t family = 0; family < queue_families.size(); family++)
+    {
+        vk::QueueFlags flags = queue_families[family].queueFlags;
+        // Compute families can always copy, whether or not they report the transfer bit
+        if (!(flags & (vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eCompute)) || (flags & vk::QueueFlagBits::eGraphics))
+            continue;
+        if (!queue_family_indices.transfer_family.has_value() || !(flags & vk::QueueFlagBits::eCompute))
+            queue_family_indices.transfer_family = family;
+    }
+    if (!queue_family_indices.transfer_family.has_value())
+        queue_family_indices.transfer_family = queue_family_indices.graphics_family;
+    app->GetLogger()->Debug(std::format("Queue Family {} Is Used For Uploads", queue_family_indices.transfer_family.value()), "VKInit");
 }
 
 //=============================================================================
@@ -228,6 +256,7 @@ void Device::CreateDevice()
     std::set<uint32_t> unique_indices;
     unique_indices.insert(queue_family_indices.graphics_family.value());
     unique_indices.insert(queue_family_indices.present_family.value());
+    unique_indices.insert(queue_family_indices.transfer_family.value());
 
     // Create queue create info for each unique queue family
     for (uint32_t queue_family_index : unique_indices)
@@ -240,8 +269,49 @@ void Device::CreateDevice()
                 .setPQueuePriorities(&queue_priority));
     }
 
-    // Setup device features (none required currently)
-    device_features = vk::PhysicalDeviceFeatures().setSamplerAnisotropy(VK_TRUE);
+    // Setup device features; the indirect draw ones are optional, Surface falls back to direct draws without them
+    vk::PhysicalDeviceFeatures supported_features = vk_physical_device.getFeatures();
+    device_features = vk::PhysicalDeviceFeatures()
+                          .setSamplerAnisotropy(VK_TRUE)
+                          .setMultiDrawIndirect(supported_features.multiDrawIndirect)
+                          .setDrawIndirectFirstInstance(supported_features.drawIndirectFirstInstance);
+
+    // drawIndexedIndirectCount is core in Vulkan 1.2, behind a feature; GPU culling uses it to skip culled draws
+    if (instance->vk_app_info.apiVersion >= VK_API_VERSION_1_2 && device_properties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        auto supported_chain = vk_physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+        draw_indirect_count  = supported_chain.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount;
+        // Uploads signal a timeline semaphore that frames wait on; without it they are waited for on the CPU
+        timeline_semaphores  = supported_chain.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore;
+    }
+    vulkan12_features = vk::PhysicalDeviceVulkan12Features()
+                            .setDrawIndirectCount(draw_indirect_count)
+                            .setTimelineSemaphore(timeline_semaphores);
+
+    // Presents signal fences with swapchain maintenance, so Surface knows when their semaphores are free again
+    if (instance->SupportsSurfaceMaintenance() && device_properties.apiVersion >= VK_API_VERSION_1_1
+        && instance->vk_app_info.apiVersion >= VK_API_VERSION_1_1)
+    {
+        for (auto& extension : vk_physical_device.enumerateDeviceExtensionProperties())
+            if (strcmp(extension.extensionName.data(), VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME) == 0)
+            {
+                auto supported_chain = vk_physical_device.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                                       vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>();
+                present_fences = supported_chain.get<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>().swapchainMaintenance1;
+            }
+    }
+    if (present_fences)
+        extensions.push_back(VK_EXT_SWAPCHAIN_MAINTENANCE_1_EXTENSION_NAME);
+    swapchain_maintenance_features =
+        vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT().setSwapchainMaintenance1(present_fences);
+
+    // Feature structures chained to the device info, for those in use
+    void* features_chain = present_fences ? &swapchain_maintenance_features : nullptr;
+    if (draw_indirect_count || timeline_semaphores)
+    {
+        vulkan12_features.setPNext(features_chain);
+        features_chain = &vulkan12_features;
+    }
 
     // Create device info structure
     vk_device_info = vk::DeviceCreateInfo()
@@ -252,7 +322,8 @@ void Device::CreateDevice()
                          .setPpEnabledLayerNames(layers.data())
                          .setEnabledExtensionCount(extensions.size())
                          .setPpEnabledExtensionNames(extensions.data())
-                         .setPEnabledFeatures(&device_features);
+                         .setPEnabledFeatures(&device_features)
+                         .setPNext(features_chain);
 
     // Create the logical device
     try
@@ -272,6 +343,7 @@ void Device::GetQueues()
     // Get handles to the created queues
     vk_graphics_queue = vk_device.getQueue(queue_family_indices.graphics_family.value(), 0);
     vk_present_queue = vk_device.getQueue(queue_family_indices.present_family.value(), 0);
+    vk_transfer_queue = vk_device.getQueue(queue_family_indices.transfer_family.value(), 0);
 }
 
 //=============================================================================
@@ -0,0 +1,178 @@
+#include "vk/frustum_culler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#define NFT_CULL_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define NFT_CULL_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace nft::vulkan
+{
+
+namespace
+{
+#if NFT_CULL_AVX
+constexpr size_t block_size = 8;
+#elif NFT_CULL_SSE
+constexpr size_t block_size = 4;
+#else
+constexpr size_t block_size = 1;
+#endif
+}	 // namespace
+
+void ExtractFrustumPlanes(const glm::mat4& view_proj, glm::vec4 planes[6])
+{
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(view_proj[0][i], view_proj[1][i], view_proj[2][i], view_proj[3][i]);
+
+	planes[0] = rows[3] + rows[0];	  // Left
+	planes[1] = rows[3] - rows[0];	  // Right
+	planes[2] = rows[3] + rows[1];	  // Bottom
+	planes[3] = rows[3] - rows[1];	  // Top
+	planes[4] = rows[2];			  // Near
+	planes[5] = rows[3] - rows[2];	  // Far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+			planes[i] /= length;
+	}
+}
+
+void FrustumCuller::Clear()
+{
+	for (std::vector<float>& component : components)
+		component.clear();
+	count = 0;
+}
+
+void FrustumCuller::Add(const glm::vec4& sphere, const glm::mat4& transform)
+{
+	// Cull pads the arrays past count; drop that padding before appending
+	for (std::vector<float>& component : components)
+		component.resize(count);
+
+	for (int i = 0; i < 4; i++)
+		components[SphereX + i].push_back(sphere[i]);
+	for (int column = 0; column < 4; column++)
+		for (int row = 0; row < 3; row++)
+			components[Transform + column * 3 + row].push_back(transform[column][row]);
+	count++;
+}
+
+void FrustumCuller::Cull(std::vector<uint8_t>& visible)
+{
+	// Padding objects are left at zero; their results are dropped
+	size_t padded = (count + block_size - 1) / block_size * block_size;
+	for (std::vector<float>& component : components)
+		component.resize(padded, 0.0f);
+
+	visible.resize(padded);
+	uint32_t visible_count = 0;
+
+	// Centers are moved by the transform and radii scaled by its largest axis scale, which keeps the world-space
+	// sphere conservative. A sphere is outside when it lies entirely behind one plane:
+	// dot(normal, center) + distance < -radius
+	for (size_t first = 0; first < padded; first += block_size)
+	{
+#if NFT_CULL_AVX
+		__m256 m[12];
+		for (int i = 0; i < 12; i++)
+			m[i] = _mm256_loadu_ps(components[Transform + i].data() + first);
+		__m256 sx = _mm256_loadu_ps(components[SphereX].data() + first);
+		__m256 sy = _mm256_loadu_ps(components[SphereY].data() + first);
+		__m256 sz = _mm256_loadu_ps(components[SphereZ].data() + first);
+
+		__m256 center[3];
+		__m256 scale[3];
+		for (int i = 0; i < 3; i++)
+		{
+			center[i] = _mm256_add_ps(_mm256_mul_ps(m[i], sx), m[9 + i]);
+			center[i] = _mm256_add_ps(center[i], _mm256_mul_ps(m[3 + i], sy));
+			center[i] = _mm256_add_ps(center[i], _mm256_mul_ps(m[6 + i], sz));
+			scale[i]  = _mm256_mul_ps(m[i * 3], m[i * 3]);
+			scale[i]  = _mm256_add_ps(scale[i], _mm256_mul_ps(m[i * 3 + 1], m[i * 3 + 1]));
+			scale[i]  = _mm256_add_ps(scale[i], _mm256_mul_ps(m[i * 3 + 2], m[i * 3 + 2]));
+		}
+		__m256 max_scale = _mm256_sqrt_ps(_mm256_max_ps(scale[0], _mm256_max_ps(scale[1], scale[2])));
+		__m256 r		 = _mm256_mul_ps(_mm256_loadu_ps(components[SphereRadius].data() + first), max_scale);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const glm::vec4& plane : frustum_planes)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_mul_ps(center[0], _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+			distance		= _mm256_add_ps(distance, _mm256_mul_ps(center[1], _mm256_set1_ps(plane.y)));
+			distance		= _mm256_add_ps(distance, _mm256_mul_ps(center[2], _mm256_set1_ps(plane.z)));
+			inside			= _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+#elif NFT_CULL_SSE
+		__m128 m[12];
+		for (int i = 0; i < 12; i++)
+			m[i] = _mm_loadu_ps(components[Transform + i].data() + first);
+		__m128 sx = _mm_loadu_ps(components[SphereX].data() + first);
+		__m128 sy = _mm_loadu_ps(components[SphereY].data() + first);
+		__m128 sz = _mm_loadu_ps(components[SphereZ].data() + first);
+
+		__m128 center[3];
+		__m128 scale[3];
+		for (int i = 0; i < 3; i++)
+		{
+			center[i] = _mm_add_ps(_mm_mul_ps(m[i], sx), m[9 + i]);
+			center[i] = _mm_add_ps(center[i], _mm_mul_ps(m[3 + i], sy));
+			center[i] = _mm_add_ps(center[i], _mm_mul_ps(m[6 + i], sz));
+			scale[i]  = _mm_mul_ps(m[i * 3], m[i * 3]);
+			scale[i]  = _mm_add_ps(scale[i], _mm_mul_ps(m[i * 3 + 1], m[i * 3 + 1]));
+			scale[i]  = _mm_add_ps(scale[i], _mm_mul_ps(m[i * 3 + 2], m[i * 3 + 2]));
+		}
+		__m128 max_scale = _mm_sqrt_ps(_mm_max_ps(scale[0], _mm_max_ps(scale[1], scale[2])));
+		__m128 r		 = _mm_mul_ps(_mm_loadu_ps(components[SphereRadius].data() + first), max_scale);
+
+		__m128 inside = _mm_cmpeq_ps(r, r);	   // All bits set
+		for (const glm::vec4& plane : frustum_planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(center[0], _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+			distance		= _mm_add_ps(distance, _mm_mul_ps(center[1], _mm_set1_ps(plane.y)));
+			distance		= _mm_add_ps(distance, _mm_mul_ps(center[2], _mm_set1_ps(plane.z)));
+			inside			= _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), _mm_setzero_ps()));
+		}
+		uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside));
+#else
+		float m[12];
+		for (int i = 0; i < 12; i++)
+			m[i] = components[Transform + i][first];
+		glm::vec3 sphere(components[SphereX][first], components[SphereY][first], components[SphereZ][first]);
+		glm::vec3 center	= glm::vec3(m[0], m[1], m[2]) * sphere.x + glm::vec3(m[3], m[4], m[5]) * sphere.y
+							+ glm::vec3(m[6], m[7], m[8]) * sphere.z + glm::vec3(m[9], m[10], m[11]);
+		float	  max_scale = std::sqrt(std::max({ m[0] * m[0] + m[1] * m[1] + m[2] * m[2],
+												   m[3] * m[3] + m[4] * m[4] + m[5] * m[5],
+												   m[6] * m[6] + m[7] * m[7] + m[8] * m[8] }));
+		float	  r			= components[SphereRadius][first] * max_scale;
+
+		uint32_t mask = 1;
+		for (const glm::vec4& plane : frustum_planes)
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -r)
+			{
+				mask = 0;
+				break;
+			}
+#endif
+		for (size_t lane = 0; lane < block_size; lane++)
+			visible[first + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+	}
+
+	visible.resize(count);
+	for (uint8_t object_visible : visible)
+		visible_count += object_visible;
+	stats.visible = visible_count;
+	stats.culled  = static_cast<uint32_t>(count) - visible_count;
+}
+
+}	 // namespace nft::vulkan
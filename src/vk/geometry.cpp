@@ -1,22 +1,72 @@
 #include "vk/geometry.h"
 
+#include "core/app.h"
 #include "core/parse_obj.h"
+#include "vk/commands.h"
+#include "vk/deletion_queue.h"
 #include "vk/handler.h"
+#include "vk/staging_ring.h"
+#include "vk/upload_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <functional>
 
 namespace nft::vulkan
 {
+namespace
+{
+// Offset of a new range, growing the allocator (at least doubling it) when no free range fits
+size_t AllocateRange(RangeAllocator& allocator, size_t size, size_t alignment, size_t minimum_capacity)
+{
+	if (size == 0)
+		return 0;
+
+	size_t offset = allocator.Allocate(size, alignment);
+	if (offset == RangeAllocator::invalid)
+	{
+		allocator.Grow(std::max({ allocator.GetCapacity() * 2, allocator.GetCapacity() + size + alignment, minimum_capacity }));
+		offset = allocator.Allocate(size, alignment);
+	}
+	return offset;
+}
+}	 // namespace
 
 //IMesh::IMesh(): vertices(std::make_unique<std::vector<float>>()), indices(std::make_unique<std::vector<uint32_t>>())
 //{
 //	// Initialize empty mesh with no vertices or indices
 //}
 
-void IMesh::LoadObj(const std::string& file_dir, const std::string& file_name)
+void IMesh::LoadObj(const std::string& file_dir, const std::string& file_name, const MeshOptimizer::Options& optimize_options)
 {
+	std::string source_path = file_dir + "/" + file_name;
+	uint32_t	cache_flags = optimize_options.GetFlags();
+
+	if (std::shared_ptr<const MeshCache> loaded_cache = MeshCache::Load(source_path, cache_flags))
+	{
+		cache  = std::move(loaded_cache);
+		bounds = cache->GetBounds();
+		material_ranges.assign(cache->GetMaterialRanges().begin(), cache->GetMaterialRanges().end());
+		vertices = std::make_unique<std::vector<float>>();
+		indices	 = std::make_unique<std::vector<uint32_t>>();
+		meshlets.clear();
+		lods.clear();
+
+		VulkanHandler::app->GetLogger()->Debug(std::format("Loaded \"{}\" from mesh cache", file_name), "VKInit");
+		return;
+	}
+
 	parse::ObjLoader obj_loader(file_dir, file_name);
 
+	const parse::ObjLoader::Stats& stats = obj_loader.GetStats();
+	VulkanHandler::app->GetLogger()->Debug(
+		std::format("Parsed \"{}\": {} bytes in {:.2f} ms ({:.1f} MB/s)", file_name, stats.bytes, stats.seconds * 1000.0, stats.GetThroughput()),
+		"VKInit");
+
 	auto new_vertices = obj_loader.GetVertices();
 	auto new_indices  = obj_loader.GetIndices();
+	cache.reset();
 
 	// Only assign if the ObjLoader successfully parsed data
 	if (new_vertices != nullptr)
@@ -44,10 +94,95 @@ void IMesh::LoadObj(const std::string& file_dir, const std::string& file_name)
 			indices = std::make_unique<std::vector<uint32_t>>();
 		}
 	}
+
+	material_ranges = obj_loader.GetMaterialRanges();
+
+	if (optimize_options.IsEnabled())
+	{
+		MeshOptimizer::Report report = MeshOptimizer::Optimize(*vertices, *indices, material_ranges, optimize_options);
+		VulkanHandler::app->GetLogger()->Debug(
+			std::format("Optimized \"{}\": ACMR {:.3f} -> {:.3f}", file_name, report.acmr_before, report.acmr_after), "VKInit");
+	}
+
+	bounds	 = ComputeBounds(*vertices);
+	meshlets = MeshletBuilder::Build(*vertices, *indices, material_ranges);
+	VulkanHandler::app->GetLogger()->Debug(std::format("Built {} meshlets for \"{}\"", meshlets.size(), file_name), "VKInit");
+
+	// Appends the simplified levels to the index data, after the meshlets were built from LOD 0
+	lods = MeshSimplifier::BuildLodChain(*vertices, *indices, optimize_options.lod_levels);
+	if (lods.size() < 2 && optimize_options.lod_levels > 1)
+		VulkanHandler::app->GetLogger()->Debug(std::format("No LODs built for \"{}\", only the full mesh is drawn", file_name),
+											   "VKInit");
+	for (size_t level = 1; level < lods.size(); level++)
+		VulkanHandler::app->GetLogger()->Debug(
+			std::format("LOD {} of \"{}\": {} triangles, error {:.4f}", level, file_name, lods[level].index_count / 3, lods[level].error),
+			"VKInit");
+
+	if (!MeshCache::Write(source_path,
+						  cache_flags,
+						  obj_loader.GetMaterialLibraries(),
+						  *vertices,
+						  *indices,
+						  material_ranges,
+						  meshlets,
+						  lods,
+						  bounds))
+		VulkanHandler::app->GetLogger()->Warn(std::format("Failed to write mesh cache for \"{}\"", file_name), "VKInit");
+}
+
+std::span<const float> IMesh::GetVertexData() const
+{
+	if (cache)
+		return cache->GetVertices();
+	if (!vertices)
+		return {};
+	return *vertices;
+}
+
+std::span<const uint32_t> IMesh::GetIndexData() const
+{
+	if (cache)
+		return cache->GetIndices();
+	if (!indices)
+		return {};
+	return *indices;
+}
+
+std::span<const Meshlet> IMesh::GetMeshlets() const
+{
+	if (cache)
+		return cache->GetMeshlets();
+	return meshlets;
+}
+
+std::span<const MeshLod> IMesh::GetLods() const
+{
+	if (cache)
+		return cache->GetLods();
+	return lods;
+}
+
+void IMesh::DetachCache()
+{
+	if (!cache)
+		return;
+
+	// Meshlets and simplified levels describe the cached geometry and would go stale with the first edit, so only
+	// the full mesh is kept; the simplified levels appended to the cached indices go with them
+	std::span<const uint32_t> cached_indices = cache->GetIndices();
+	if (!cache->GetLods().empty())
+		cached_indices = cached_indices.first(cache->GetLods()[0].index_count);
+
+	vertices = std::make_unique<std::vector<float>>(cache->GetVertices().begin(), cache->GetVertices().end());
+	indices	 = std::make_unique<std::vector<uint32_t>>(cached_indices.begin(), cached_indices.end());
+	meshlets.clear();
+	lods.clear();
+	cache.reset();
 }
 
 void SimpleMesh::AddVertex(VertexData vertex)
 {
+	DetachCache();
 	vertices->push_back(vertex.x);
 	vertices->push_back(vertex.y);
 	vertices->push_back(vertex.z);
@@ -60,7 +195,7 @@ void SimpleMesh::AddVertex(VertexData vertex)
 	// vertex_count++;
 }
 
-GeometryBatcher::GeometryBatcher(Device* device): device(device)
+GeometryBatcher::GeometryBatcher(Device* device, VertexFormat vertex_format): device(device), vertex_format(vertex_format)
 {
 	if (!device)
 		NFT_ERROR(VulkanFatal, "Device Is Null!");
@@ -68,23 +203,118 @@ GeometryBatcher::GeometryBatcher(Device* device): device(device)
 
 void GeometryBatcher::AddGeometry(const IMesh* mesh)
 {
-	// Calculate vertex count - each vertex has 12 floats (x, y, z, r, g, b, a, u, v)
-	size_t vertex_count = mesh->vertices->size() / 12;
-	// Calculate current vertex offset in the batched buffer (number of vertices, not bytes)
-	size_t vertex_offset = vertex_data.size() / 12;
-
-	size_t index_count	= 0;	// Default to 0 if no indices are present
-	size_t index_offset = 0;	// Default to 0 if no indices are present
-	// If indices are present, we need to calculate based on indices
-	if (!mesh->indices->empty())
+	if (mesh_data.contains(mesh))
 	{
-		index_count	 = mesh->indices->size();
-		index_offset = index_data.size();	 // Offset in the batched buffer
+		UpdateGeometry(mesh);
+		return;
 	}
 
-	mesh_data[mesh] = { vertex_offset, vertex_count, index_offset, index_count };
-	vertex_data.insert(vertex_data.end(), mesh->vertices->begin(), mesh->vertices->end());
-	index_data.insert(index_data.end(), mesh->indices->begin(), mesh->indices->end());
+	std::span<const float>	  vertices = mesh->GetVertexData();
+	std::span<const uint32_t> indices  = mesh->GetIndexData();
+
+	// Each vertex has 12 floats (x, y, z, r, g, b, a, u, v, nx, ny, nz)
+	size_t vertex_count = vertices.size() / MeshCache::vertex_stride;
+
+	// Only ranges are reserved here; the data itself is packed straight from the mesh into staging memory on Upload
+	MeshData data;
+	data.id			= next_mesh_id++;
+	data.size		= vertex_count;
+	data.index_size = indices.size();
+	data.index_type = vertex_count < 65536 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	data.bounds		= ComputeBounds(vertices);
+	data.sphere		= ComputeBoundingSphere(vertices, data.bounds);
+	data.offset		= AllocateRange(vertex_allocator, vertex_count, 1, initial_vertex_capacity);
+
+	// Keep every mesh's indices 4-byte aligned so either index type can address them with firstIndex
+	size_t index_stride = data.GetIndexStride();
+	data.index_offset	= AllocateRange(index_allocator, indices.size() * index_stride, 4, initial_index_capacity) / index_stride;
+
+	for (const MeshLod& lod : mesh->GetLods())
+		data.lods.push_back({ static_cast<uint32_t>(data.index_offset + lod.first_index), lod.index_count, lod.error });
+	if (data.lods.empty() && !indices.empty())
+		data.lods.push_back({ static_cast<uint32_t>(data.index_offset), static_cast<uint32_t>(indices.size()), 0.0f });
+
+	mesh_data[mesh] = std::move(data);
+	pending_uploads.push_back(mesh);
+}
+
+void GeometryBatcher::UpdateGeometry(const IMesh* mesh)
+{
+	// The new data goes to new ranges while frames in flight still read the old ones; with nothing in flight the
+	// old ranges are freed right away and taken back if the size didn't change
+	RemoveGeometry(mesh);
+	AddGeometry(mesh);
+}
+
+void GeometryBatcher::RemoveGeometry(const IMesh* mesh)
+{
+	auto mesh_it = mesh_data.find(mesh);
+	if (mesh_it == mesh_data.end())
+		return;
+
+	const MeshData& data = mesh_it->second;
+	FreeRanges(data.offset, data.size, data.index_offset * data.GetIndexStride(), data.index_size * data.GetIndexStride());
+
+	mesh_data.erase(mesh_it);
+	std::erase(pending_uploads, mesh);
+}
+
+void GeometryBatcher::FreeRanges(size_t vertex_offset, size_t vertex_count, size_t index_offset, size_t index_bytes)
+{
+	device->GetDeletionQueue()->Push(
+		[this, lifetime = std::weak_ptr<bool>(lifetime), vertex_offset, vertex_count, index_offset, index_bytes]()
+		{
+			if (lifetime.expired())
+				return;
+			if (vertex_count > 0)
+				vertex_allocator.Free(vertex_offset, vertex_count);
+			if (index_bytes > 0)
+				index_allocator.Free(index_offset, index_bytes);
+		});
+}
+
+glm::mat4 GeometryBatcher::GetMeshTransform(const IMesh* mesh) const
+{
+	if (vertex_format != VertexFormat::Compact)
+		return glm::mat4(1.0f);
+
+	auto mesh_it = mesh_data.find(mesh);
+	if (mesh_it == mesh_data.end())
+		return glm::mat4(1.0f);
+	return GetDequantizeTransform(mesh_it->second.bounds);
+}
+
+Bounds GeometryBatcher::GetVertexBounds(const MeshData& data) const
+{
+	// Compact positions are quantized to unorm within the bounds
+	if (vertex_format == VertexFormat::Compact)
+		return { glm::vec3(0.0f), glm::vec3(1.0f) };
+	return data.bounds;
+}
+
+size_t GeometryBatcher::SelectLod(const MeshData&	data,
+								  const glm::mat4& transform,
+								  const glm::vec3& camera_position,
+								  float			   pixel_scale,
+								  float			   max_pixel_error)
+{
+	if (data.lods.size() < 2)
+		return 0;
+
+	// Bounding sphere of the mesh in world space; the largest axis scale keeps it conservative
+	float max_scale = std::sqrt(std::max({ glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+										   glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+										   glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])) }));
+	glm::vec3 center	= glm::vec3(transform * glm::vec4((data.bounds.min + data.bounds.max) * 0.5f, 1.0f));
+	float	  radius	= glm::length(data.bounds.max - data.bounds.min) * 0.5f * max_scale;
+	float	  distance	= glm::length(center - camera_position) - radius;
+	if (distance <= 0.0f)
+		return 0;
+
+	size_t level = 0;
+	while (level + 1 < data.lods.size() && data.lods[level + 1].error * max_scale * pixel_scale / distance <= max_pixel_error)
+		level++;
+	return level;
 }
 
 // void GeometryBatcher::Batch()
@@ -97,48 +327,283 @@ void GeometryBatcher::AddGeometry(const IMesh* mesh)
 //	}
 // }
 
-void GeometryBatcher::CreateBuffers(vk::CommandBuffer command_buffer, vk::Queue queue)
+void GeometryBatcher::Upload(vk::CommandBuffer command_buffer, vk::Queue queue)
 {
-	size_t	memory_size	   = vertex_data.size() * sizeof(float);
-	Buffer* staging_buffer = device->GetBufferManager()->CreateBuffer(memory_size,
-																	  vk::BufferUsageFlagBits::eTransferSrc,
-																	  vk::MemoryPropertyFlagBits::eHostVisible |
-																		  vk::MemoryPropertyFlagBits::eHostCoherent);
+	if (pending_uploads.empty())
+		return;
 
-	void* memory_ptr = device->GetDevice().mapMemory(
-		staging_buffer->vk_memory, 0, staging_buffer->vk_memory_info.allocationSize, vk::MemoryMapFlags());
-	memcpy(memory_ptr, vertex_data.data(), memory_size);
-	device->GetDevice().unmapMemory(staging_buffer->vk_memory);
+	const size_t vertex_size  = GetVertexSize(vertex_format);
+	const size_t vertex_bytes = vertex_allocator.GetCapacity() * vertex_size;
+	const size_t index_bytes  = index_allocator.GetCapacity();
+	auto		 buffer_size  = [this](BufferHandle buffer)
+	{ return buffer ? device->GetBufferManager()->Get(buffer)->vk_buffer_info.size : 0; };
+	if (vertex_bytes > buffer_size(vertex_buffer) || index_bytes > buffer_size(index_buffer))
+	{
+		// Both buffers grow in one submission. Their contents move over once earlier uploads into them landed, and
+		// the old buffers go once the copies are done.
+		device->GetUploadScheduler()->WaitIdle();
+		commands::CommandBatch batch(device->GetDevice(), command_buffer, queue);
+		BufferHandle old_vertices = GrowBuffer(vertex_buffer, vertex_bytes, vk::BufferUsageFlagBits::eVertexBuffer, batch);
+		BufferHandle old_indices  = GrowBuffer(index_buffer, index_bytes, vk::BufferUsageFlagBits::eIndexBuffer, batch);
+		batch.Submit();
+		if (old_vertices)
+			device->GetBufferManager()->DestroyBuffer(old_vertices);
+		if (old_indices)
+			device->GetBufferManager()->DestroyBuffer(old_indices);
+	}
 
-	vertex_buffer =
-		device->GetBufferManager()->CreateBuffer(memory_size,
-												 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-												 vk::MemoryPropertyFlagBits::eDeviceLocal);
+	size_t staging_size = 0;
+	for (const IMesh* mesh : pending_uploads)
+	{
+		const MeshData& data = mesh_data.at(mesh);
+		staging_size += data.size * vertex_size + data.index_size * data.GetIndexStride();
+	}
+	if (staging_size == 0)
+	{
+		pending_uploads.clear();
+		return;
+	}
 
-	device->GetBufferManager()->CopyBuffer(staging_buffer, vertex_buffer, memory_size, command_buffer, queue);
-	device->GetBufferManager()->DestroyBuffer(staging_buffer);
+	// Meshes are packed straight into the staging ring. When it is full the copies staged so far are submitted to
+	// make room, and meshes larger than the ring go through it in pieces. Submissions go to the upload scheduler
+	// without waiting; frames wait for them on the GPU.
+	StagingRing*				ring	   = device->GetStagingRing();
+	UploadScheduler*			uploads	   = device->GetUploadScheduler();
+	vk::Buffer					vertex_dst = device->GetBufferManager()->Get(vertex_buffer)->vk_buffer;
+	vk::Buffer					index_dst  = index_buffer ? device->GetBufferManager()->Get(index_buffer)->vk_buffer : nullptr;
+	std::vector<vk::BufferCopy> vertex_copies;
+	std::vector<vk::BufferCopy> index_copies;
 
-	if (index_data.empty())
-		return;
+	auto submit = [&]()
+	{
+		if (vertex_copies.empty() && index_copies.empty())
+			return;
+		vk::CommandBuffer upload_buffer = uploads->Begin();
+		if (!vertex_copies.empty())
+			upload_buffer.copyBuffer(ring->GetBuffer(), vertex_dst, static_cast<uint32_t>(vertex_copies.size()), vertex_copies.data());
+		if (!index_copies.empty())
+			upload_buffer.copyBuffer(ring->GetBuffer(), index_dst, static_cast<uint32_t>(index_copies.size()), index_copies.data());
+		uploads->Submit(ring->EndBatch());
+		vertex_copies.clear();
+		index_copies.clear();
+	};
+	auto stage = [&](size_t size)
+	{
+		StagingRing::Range range = ring->Allocate(size);
+		if (range.size == 0)
+		{
+			submit();
+			range = ring->Allocate(size);
+		}
+		return range;
+	};
+
+	const size_t chunk_vertices = ring->GetCapacity() / vertex_size;
+	for (const IMesh* mesh : pending_uploads)
+	{
+		const MeshData&		   data		= mesh_data.at(mesh);
+		std::span<const float> vertices = mesh->GetVertexData();
+		for (size_t first = 0; first < data.size; first += chunk_vertices)
+		{
+			size_t			   count = std::min(data.size - first, chunk_vertices);
+			StagingRing::Range range = stage(count * vertex_size);
+			PackVertices(vertices.subspan(first * MeshCache::vertex_stride, count * MeshCache::vertex_stride),
+						 data.bounds,
+						 vertex_format,
+						 range.data);
+			vertex_copies.push_back(vk::BufferCopy(range.offset, (data.offset + first) * vertex_size, count * vertex_size));
+		}
+
+		std::span<const uint32_t> indices		= mesh->GetIndexData();
+		const size_t			  stride		= data.GetIndexStride();
+		const size_t			  chunk_indices = ring->GetCapacity() / stride;
+		for (size_t first = 0; first < indices.size(); first += chunk_indices)
+		{
+			size_t			   count = std::min(indices.size() - first, chunk_indices);
+			StagingRing::Range range = stage(count * stride);
+			if (data.index_type == vk::IndexType::eUint16)
+			{
+				uint16_t* dst = reinterpret_cast<uint16_t*>(range.data);
+				for (size_t i = 0; i < count; i++)
+					dst[i] = static_cast<uint16_t>(indices[first + i]);
+			}
+			else
+				memcpy(range.data, indices.data() + first, count * stride);
+			index_copies.push_back(vk::BufferCopy(range.offset, (data.index_offset + first) * stride, count * stride));
+		}
+	}
+	submit();
+
+	VulkanHandler::app->GetLogger()->Debug(
+		std::format("Uploaded {} meshes ({} KB); {} of {} vertices and {} of {} KB of indices in use",
+					pending_uploads.size(),
+					staging_size / 1024,
+					vertex_allocator.GetUsed(),
+					vertex_allocator.GetCapacity(),
+					index_allocator.GetUsed() / 1024,
+					index_allocator.GetCapacity() / 1024),
+		"VKInit");
+
+	pending_uploads.clear();
+}
+
+bool GeometryBatcher::Compact(size_t byte_budget, vk::CommandBuffer command_buffer)
+{
+	std::pair<size_t, size_t> changes = { vertex_allocator.GetChangeCount(), index_allocator.GetChangeCount() };
+	if (!vertex_buffer || changes == compaction_stalled_at)
+		return false;
+
+	const size_t vertex_size = GetVertexSize(vertex_format);
+	size_t		 moved_bytes = 0;
+	bool		 incomplete	 = false;
+
+	// Meshes waiting for Upload have nothing on the GPU to move yet
+	auto is_pending = [this](const IMesh* mesh)
+	{ return std::find(pending_uploads.begin(), pending_uploads.end(), mesh) != pending_uploads.end(); };
+
+	// Highest ranges first, each into the lowest free range below it. Sources are only freed once the frames and
+	// uploads that may read them are done, so a target never overlaps a source of this pass or one in flight.
+	std::vector<std::pair<size_t, const IMesh*>> ranges;
+	for (const auto& [mesh, data] : mesh_data)
+		if (data.size > 0 && !is_pending(mesh))
+			ranges.push_back({ data.offset, mesh });
+	std::sort(ranges.begin(), ranges.end(), std::greater());
+
+	std::vector<vk::BufferCopy> vertex_moves;
+	for (const auto& [offset, mesh] : ranges)
+	{
+		MeshData& data	= mesh_data.at(mesh);
+		size_t	  bytes = data.size * vertex_size;
+		if (moved_bytes > 0 && moved_bytes + bytes > byte_budget)
+		{
+			incomplete = true;
+			break;
+		}
+
+		size_t target = vertex_allocator.AllocateBelow(data.size, 1, data.offset);
+		if (target == RangeAllocator::invalid)
+			continue;
+
+		vertex_moves.push_back(vk::BufferCopy(data.offset * vertex_size, target * vertex_size, bytes));
+		FreeRanges(data.offset, data.size, 0, 0);
+		data.offset = target;
+		moved_bytes += bytes;
+	}
+
+	ranges.clear();
+	for (const auto& [mesh, data] : mesh_data)
+		if (data.index_size > 0 && !is_pending(mesh))
+			ranges.push_back({ data.index_offset * data.GetIndexStride(), mesh });
+	std::sort(ranges.begin(), ranges.end(), std::greater());
 
-	memory_size	   = index_data.size() * sizeof(uint32_t);
-	staging_buffer = device->GetBufferManager()->CreateBuffer(memory_size,
-															  vk::BufferUsageFlagBits::eTransferSrc,
-															  vk::MemoryPropertyFlagBits::eHostVisible |
-																  vk::MemoryPropertyFlagBits::eHostCoherent);
+	std::vector<vk::BufferCopy> index_moves;
+	for (const auto& [offset, mesh] : ranges)
+	{
+		if (incomplete)
+			break;
 
-	memory_ptr = device->GetDevice().mapMemory(
-		staging_buffer->vk_memory, 0, staging_buffer->vk_memory_info.allocationSize, vk::MemoryMapFlags());
-	memcpy(memory_ptr, index_data.data(), memory_size);
-	device->GetDevice().unmapMemory(staging_buffer->vk_memory);
+		MeshData& data	= mesh_data.at(mesh);
+		size_t	  bytes = data.index_size * data.GetIndexStride();
+		if (moved_bytes > 0 && moved_bytes + bytes > byte_budget)
+		{
+			incomplete = true;
+			break;
+		}
+
+		size_t target = index_allocator.AllocateBelow(bytes, 4, offset);
+		if (target == RangeAllocator::invalid)
+			continue;
+
+		index_moves.push_back(vk::BufferCopy(offset, target, bytes));
+		FreeRanges(0, 0, offset, bytes);
+
+		// LOD ranges are absolute, so they move along with the mesh
+		size_t new_index_offset = target / data.GetIndexStride();
+		for (LodRange& lod : data.lods)
+			lod.first_index = static_cast<uint32_t>(lod.first_index - data.index_offset + new_index_offset);
+		data.index_offset = new_index_offset;
+		moved_bytes += bytes;
+	}
+
+	// Frames submitted earlier may still draw from the buffers, so the copies wait for their vertex input, and the
+	// draws recorded after them see the moved data. Uploads into the buffers are waited for at the frame's
+	// transfer stage, along with its other waits on the upload semaphore.
+	auto barrier = [&](vk::Buffer			   buffer,
+					   vk::PipelineStageFlags src_stage,
+					   vk::PipelineStageFlags dst_stage,
+					   vk::AccessFlags		   src_access,
+					   vk::AccessFlags		   dst_access)
+	{
+		vk::BufferMemoryBarrier buffer_barrier = vk::BufferMemoryBarrier()
+													 .setSrcAccessMask(src_access)
+													 .setDstAccessMask(dst_access)
+													 .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+													 .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+													 .setBuffer(buffer)
+													 .setOffset(0)
+													 .setSize(VK_WHOLE_SIZE);
+		command_buffer.pipelineBarrier(src_stage, dst_stage, vk::DependencyFlags(), nullptr, buffer_barrier, nullptr);
+	};
+	auto copy = [&](BufferHandle buffer, vk::AccessFlags read, const std::vector<vk::BufferCopy>& moves)
+	{
+		if (moves.empty())
+			return;
+		vk::Buffer vk_buffer = device->GetBufferManager()->Get(buffer)->vk_buffer;
+		barrier(vk_buffer,
+				vk::PipelineStageFlagBits::eVertexInput,
+				vk::PipelineStageFlagBits::eTransfer,
+				read,
+				vk::AccessFlagBits::eTransferWrite);
+		command_buffer.copyBuffer(vk_buffer, vk_buffer, static_cast<uint32_t>(moves.size()), moves.data());
+		barrier(vk_buffer,
+				vk::PipelineStageFlagBits::eTransfer,
+				vk::PipelineStageFlagBits::eVertexInput,
+				vk::AccessFlagBits::eTransferWrite,
+				read);
+	};
+	copy(vertex_buffer, vk::AccessFlagBits::eVertexAttributeRead, vertex_moves);
+	copy(index_buffer, vk::AccessFlagBits::eIndexRead, index_moves);
+
+	// Nothing could move: the next pass would only find the same, so it waits for ranges to be taken or freed.
+	// Meshes still waiting for Upload were skipped, and get their chance once uploaded.
+	if (moved_bytes == 0 && pending_uploads.empty())
+		compaction_stalled_at = changes;
+
+	if (moved_bytes > 0)
+	{
+		FragmentationStats stats = GetFragmentationStats();
+		VulkanHandler::app->GetLogger()->Debug(std::format("Compacted {} KB of geometry, fragmentation now {:.2f} (vertices) / {:.2f} (indices)",
+														   moved_bytes / 1024,
+														   stats.vertices.GetFragmentation(),
+														   stats.indices.GetFragmentation()),
+											   "VKRender");
+	}
+	return incomplete;
+}
+
+BufferHandle GeometryBatcher::GrowBuffer(BufferHandle&			 buffer,
+										 size_t					 size,
+										 vk::BufferUsageFlags	 usage,
+										 commands::CommandBatch& batch)
+{
+	size_t current_size = buffer ? device->GetBufferManager()->Get(buffer)->vk_buffer_info.size : 0;
+	if (size <= current_size)
+		return BufferHandle();
 
-	index_buffer =
-		device->GetBufferManager()->CreateBuffer(memory_size,
-												 vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-												 vk::MemoryPropertyFlagBits::eDeviceLocal);
+	// Transfer source as well, so the buffer can be copied into its successor when it grows again. Shared with the
+	// upload queue, which writes ranges of it while frames read others.
+	BufferHandle grown = device->GetBufferManager()->CreateBuffer(size,
+																  usage | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc,
+																  vk::MemoryPropertyFlagBits::eDeviceLocal,
+																  true);
+	BufferHandle old = buffer;
+	// Ranges keep their offsets, so the old contents move over as they are
+	if (old)
+		device->GetBufferManager()->CopyBuffer(old, grown, current_size, nullptr, nullptr, &batch);
+	buffer = grown;
 
-	device->GetBufferManager()->CopyBuffer(staging_buffer, index_buffer, memory_size, command_buffer, queue);
-	device->GetBufferManager()->DestroyBuffer(staging_buffer);
+	VulkanHandler::app->GetLogger()->Debug(std::format("Grew geometry buffer to {} KB", size / 1024), "VKInit");
+	return old;
 }
 
 }	 // namespace nft::vulkan
\ No newline at end of file
@@ -4,7 +4,12 @@
 #include "extern/stb_image.h"
 
 #include "vk/commands.h"
+#include "vk/deletion_queue.h"
 #include "vk/handler.h"
+#include "vk/staging_ring.h"
+#include "vk/upload_scheduler.h"
+
+#include <optional>
 
 namespace nft::vulkan
 {
@@ -22,21 +27,34 @@ Image::~Image()
 		stbi_image_free(pixels);
 		pixels = nullptr;
 	}
-	if (vk_image_view && device && device->vk_device)
-	{
-		device->vk_device.destroyImageView(vk_image_view);
-		vk_image_view = VK_NULL_HANDLE;
-	}
-	if (vk_image && device && device->vk_device)
-	{
-		device->vk_device.destroyImage(vk_image);
-		vk_image = VK_NULL_HANDLE;
-	}
-	if (vk_memory && device && device->vk_device)
+	Cleanup();
+}
+
+void Image::Cleanup()
+{
+	// Frames or uploads in flight may still use the image, so it is released through the deletion queue. Images
+	// without memory of their own, like swapchain images, belong to someone else and are only let go of.
+	if (device && device->vk_device && (vk_image_view || vk_memory))
 	{
-		device->vk_device.freeMemory(vk_memory);
-		vk_memory = VK_NULL_HANDLE;
+		device->GetDeletionQueue()->Push(
+			[device = device, view = vk_image_view, image = vk_memory ? vk_image : vk::Image(), allocation = memory_allocation]() mutable
+			{
+				if (view)
+					device->vk_device.destroyImageView(view);
+				if (image)
+					device->vk_device.destroyImage(image);
+				if (allocation.memory)
+					device->buffer_manager->allocator.Free(allocation);
+			});
 	}
+	vk_image_view	   = VK_NULL_HANDLE;
+	vk_image		   = VK_NULL_HANDLE;
+	vk_memory		   = VK_NULL_HANDLE;
+	memory_allocation  = {};
+	image_initialized  = false;
+	memory_bound	   = false;
+	image_created	   = false;
+	image_view_created = false;
 }
 
 Image::Image(Image&& other) noexcept:
@@ -58,6 +76,7 @@ Image::Image(Image&& other) noexcept:
 	pixels(other.pixels),
 	vk_image(other.vk_image),
 	vk_memory(other.vk_memory),
+	memory_allocation(other.memory_allocation),
 	vk_image_view(other.vk_image_view),
 	vk_sampler(other.vk_sampler),
 	descriptor_set_layout(std::move(other.descriptor_set_layout)),
@@ -68,6 +87,7 @@ Image::Image(Image&& other) noexcept:
 	other.pixels				 = nullptr;
 	other.vk_image				 = VK_NULL_HANDLE;
 	other.vk_memory				 = VK_NULL_HANDLE;
+	other.memory_allocation		 = {};
 	other.vk_image_view			 = VK_NULL_HANDLE;
 	other.vk_sampler			 = VK_NULL_HANDLE;
 	other.vk_descriptor_set		 = VK_NULL_HANDLE;
@@ -210,10 +230,14 @@ void Image::InitMemory(vk::MemoryPropertyFlags memory_properties)
 		vk::MemoryAllocateInfo()
 			.setAllocationSize(vk_memory_requirements.size)
 			.setMemoryTypeIndex(device->buffer_manager->FindMemoryType(vk_memory_requirements.memoryTypeBits, memory_properties));
+	// Linear images may sit next to buffers; optimal ones are kept apart from them (bufferImageGranularity)
+	memory_allocation = device->buffer_manager->allocator.Allocate(vk_memory_requirements,
+																   vk_memory_allocate_info.memoryTypeIndex,
+																   vk_image_info.tiling == vk::ImageTiling::eLinear);
+	vk_memory		  = memory_allocation.memory;
 	try
 	{
-		vk_memory = device->vk_device.allocateMemory(vk_memory_allocate_info);
-		device->vk_device.bindImageMemory(vk_image, vk_memory, 0);
+		device->vk_device.bindImageMemory(vk_image, vk_memory, memory_allocation.offset);
 	}
 	catch (const vk::SystemError& err)
 	{
@@ -241,30 +265,94 @@ void Image::UploadPixelData(const void* pixels, size_t size, vk::ImageLayout fin
 		NFT_ERROR(VulkanFatal, "Pixel data is null!");
 	if (size < 1)
 		NFT_ERROR(VulkanFatal, "Size of pixel data must be greater than zero!");
-	// Create staging buffer
-	Buffer* staging_buffer = device->buffer_manager->CreateBuffer(size,
-																  vk::BufferUsageFlagBits::eTransferSrc,
-																  vk::MemoryPropertyFlagBits::eHostCoherent |
-																	  vk::MemoryPropertyFlagBits::eHostVisible);
-
-	// Map memory and copy pixel data
-	void* write_ptr = device->vk_device.mapMemory(
-		staging_buffer->vk_memory, 0, staging_buffer->vk_memory_info.allocationSize, vk::MemoryMapFlags());
-	if (pixels && size > 0)
-		std::memcpy(write_ptr, pixels, size);
-	device->vk_device.unmapMemory(staging_buffer->vk_memory);
 
-	// Transition to transfer destination layout
-	TransistionLayout(vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-
-	// Copy buffer to image
-	CopyBufferToImage(staging_buffer->vk_buffer, vk_image, width, height);
+	// Everything is recorded on the upload queue and submitted without waiting; frames using the image wait for it
+	// on the GPU. Pixels go through the staging ring, as many rows at a time as it holds, unless the queue can only
+	// copy chunks larger than the ring.
+	UploadScheduler*  uploads		 = device->GetUploadScheduler();
+	StagingRing*	  ring			 = device->GetStagingRing();
+	vk::CommandBuffer command_buffer = uploads->Begin();
+
+	command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
+								   vk::PipelineStageFlagBits::eTransfer,
+								   vk::DependencyFlags(),
+								   nullptr,
+								   nullptr,
+								   vk::ImageMemoryBarrier()
+									   .setOldLayout(vk::ImageLayout::eUndefined)
+									   .setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+									   .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+									   .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+									   .setImage(vk_image)
+									   .setSubresourceRange(vk_subresource_range)
+									   .setSrcAccessMask(vk::AccessFlagBits::eNone)
+									   .setDstAccessMask(vk::AccessFlagBits::eTransferWrite));
+
+	// Chunks start on rows the upload queue can copy to; a granularity of 0 allows only the whole image at once
+	const size_t   row_size	   = size / height;
+	const uint32_t granularity = uploads->GetImageGranularity().height;
+	uint32_t	   chunk_rows  = static_cast<uint32_t>(std::max<size_t>(ring->GetCapacity() / row_size, 1));
+	if (granularity == 0)
+		chunk_rows = static_cast<uint32_t>(height);
+	else if (chunk_rows > granularity)
+		chunk_rows -= chunk_rows % granularity;
+	else
+		chunk_rows = granularity;
 
-	// Transition to shader read-only layout
-	TransistionLayout(vk::ImageLayout::eTransferDstOptimal, final_layout);
+	auto copy_rows = [&](vk::Buffer buffer, vk::DeviceSize offset, uint32_t first_row, uint32_t row_count)
+	{
+		vk::BufferImageCopy buffer_image_copy = vk::BufferImageCopy()
+													.setBufferOffset(offset)
+													.setBufferRowLength(0)
+													.setBufferImageHeight(0)
+													.setImageSubresource(vk_subresource_layers)
+													.setImageOffset(vk::Offset3D(0, static_cast<int32_t>(first_row), 0))
+													.setImageExtent(vk::Extent3D(width, row_count, 1));
+		command_buffer.copyBufferToImage(buffer, vk_image, vk::ImageLayout::eTransferDstOptimal, 1, &buffer_image_copy);
+	};
+
+	BufferHandle staging;
+	if (chunk_rows * row_size > ring->GetCapacity())
+	{
+		// The smallest chunk the queue can copy doesn't fit the ring; the image is staged in a buffer of its own,
+		// destroyed once the upload is done
+		staging = device->GetBufferManager()->CreateBuffer(size,
+														   vk::BufferUsageFlagBits::eTransferSrc,
+														   vk::MemoryPropertyFlagBits::eHostVisible |
+															   vk::MemoryPropertyFlagBits::eHostCoherent);
+		Buffer* staging_buffer = device->GetBufferManager()->Get(staging);
+		if (!staging_buffer || !staging_buffer->mapped)
+			NFT_ERROR(VulkanFatal, std::format("Failed To Create A {} Byte Staging Buffer For Image Upload!", size));
+
+		std::memcpy(staging_buffer->mapped, pixels, size);
+		copy_rows(staging_buffer->vk_buffer, 0, 0, static_cast<uint32_t>(height));
+	}
+	else
+	{
+		for (uint32_t first_row = 0; first_row < static_cast<uint32_t>(height); first_row += chunk_rows)
+		{
+			uint32_t		   row_count = std::min(static_cast<uint32_t>(height) - first_row, chunk_rows);
+			StagingRing::Range range	 = ring->Allocate(row_count * row_size);
+			if (range.size == 0)
+			{
+				// The rows recorded so far hold the ring; submit them to make room
+				uploads->Submit(ring->EndBatch());
+				command_buffer = uploads->Begin();
+				range		   = ring->Allocate(row_count * row_size);
+				if (range.size == 0)
+					NFT_ERROR(VulkanFatal,
+							  std::format("Failed To Stage {} Bytes Of Pixel Data In The Staging Ring!", row_count * row_size));
+			}
+
+			std::memcpy(range.data, static_cast<const char*>(pixels) + first_row * row_size, row_count * row_size);
+			copy_rows(ring->GetBuffer(), range.offset, first_row, row_count);
+		}
+	}
 
-	// Cleanup staging buffer
-	device->buffer_manager->DestroyBuffer(staging_buffer);
+	uploads->ReleaseImage(command_buffer, vk_image, vk_subresource_range, vk::ImageLayout::eTransferDstOptimal, final_layout);
+	uploads->Submit(ring->EndBatch());
+	if (staging)
+		device->GetBufferManager()->DestroyBuffer(staging);
 
 	image_created = true;
 	CreateImageView(vk::Format::eR8G8B8A8Unorm);
@@ -292,13 +380,11 @@ void Image::AllocateDescriptorSet()
 	}
 }
 
-void Image::TransistionLayout(vk::ImageLayout old_layout, vk::ImageLayout new_layout)
+void Image::TransistionLayout(vk::ImageLayout old_layout, vk::ImageLayout new_layout, commands::CommandBatch* batch)
 {
 	if (!image_initialized)
 		NFT_ERROR(VulkanFatal, "Image is not initialized! Call Init() before transitioning layout.");
 
-	commands::StartJob(vk_command_buffer, vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
 	vk::ImageMemoryBarrier image_memory_barrier = vk::ImageMemoryBarrier()
 													  .setOldLayout(old_layout)
 													  .setNewLayout(new_layout)
@@ -326,27 +412,37 @@ void Image::TransistionLayout(vk::ImageLayout old_layout, vk::ImageLayout new_la
 	else
 		NFT_ERROR(VulkanFatal, "Unsupported layout transition!");
 
-	vk_command_buffer.pipelineBarrier(
-		src_stage, dst_stage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &image_memory_barrier);
-
-	commands::EndJob(vk_command_buffer, vk_queue);
+	// Barriers next to each other in a batch end up in one vkCmdPipelineBarrier
+	std::optional<commands::CommandBatch> own_batch;
+	if (!batch)
+		batch = &own_batch.emplace(device->vk_device, vk_command_buffer, vk_queue);
+	batch->Barrier(src_stage, dst_stage, image_memory_barrier);
+	if (own_batch)
+		own_batch->Submit();
 }
 
-void Image::CopyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height)
+void Image::CopyBufferToImage(vk::Buffer			  buffer,
+							  vk::DeviceSize		  buffer_offset,
+							  vk::Image				  image,
+							  uint32_t				  first_row,
+							  uint32_t				  row_count,
+							  vk::Fence				  fence,
+							  commands::CommandBatch* batch)
 {
-	commands::StartJob(vk_command_buffer, vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-
 	vk::BufferImageCopy buffer_image_copy = vk::BufferImageCopy()
-												.setBufferOffset(0)
+												.setBufferOffset(buffer_offset)
 												.setBufferRowLength(0)
 												.setBufferImageHeight(0)
 												.setImageSubresource(vk_subresource_layers)
-												.setImageOffset(vk::Offset3D(0, 0, 0))
-												.setImageExtent(vk::Extent3D(width, height, 1));
-
-	vk_command_buffer.copyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, 1, &buffer_image_copy);
-
-	commands::EndJob(vk_command_buffer, vk_queue);
+												.setImageOffset(vk::Offset3D(0, static_cast<int32_t>(first_row), 0))
+												.setImageExtent(vk::Extent3D(width, row_count, 1));
+
+	std::optional<commands::CommandBatch> own_batch;
+	if (!batch)
+		batch = &own_batch.emplace(device->vk_device, vk_command_buffer, vk_queue);
+	batch->CopyBufferToImage(buffer, image, vk::ImageLayout::eTransferDstOptimal, std::span(&buffer_image_copy, 1));
+	if (own_batch)
+		own_batch->Submit(fence);
 }
 
 void Image::CreateImageView(vk::Format format)
@@ -388,7 +484,9 @@ void Image::Bind(vk::CommandBuffer	   command_buffer,
 
 Texture::~Texture()
 {
-	device->vk_device.destroySampler(vk_sampler);
+	// Frames in flight may still sample with it
+	if (vk_sampler)
+		device->GetDeletionQueue()->Push([device = device, sampler = vk_sampler]() { device->vk_device.destroySampler(sampler); });
 	vk_sampler		= VK_NULL_HANDLE;
 	sampler_created = false;
 }
@@ -398,14 +496,40 @@ void Texture::LoadFile(std::string file_path)
 	if (!commands_setup)
 		NFT_ERROR(VulkanFatal, "Commands are not setup! Call SetupCommands() before loading a file.");
 
-	pixels = stbi_load(file_path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-	if (!pixels)
+	TextureData data = Decode(file_path);
+	if (!data.IsValid())
 		NFT_ERROR(VulkanFatal, "Failed To Load Image File: " + file_path);
 
+	Upload(data);
+}
+
+TextureData Texture::Decode(const std::string& file_path)
+{
+	TextureData data;
+	int			channels = 0;
+	stbi_uc*	decoded	 = stbi_load(file_path.c_str(), &data.width, &data.height, &channels, STBI_rgb_alpha);
+	if (!decoded)
+		return TextureData();
+
+	data.pixels.assign(decoded, decoded + static_cast<size_t>(data.width) * data.height * 4);
+	stbi_image_free(decoded);
+	return data;
+}
+
+void Texture::Upload(const TextureData& data)
+{
+	if (!commands_setup)
+		NFT_ERROR(VulkanFatal, "Commands are not setup! Call SetupCommands() before uploading a texture.");
+	if (!data.IsValid())
+		NFT_ERROR(VulkanFatal, "Texture data is empty!");
+
+	if (image_initialized)
+		Cleanup();
+
 	Init(vk::ImageCreateInfo()
 			 .setFlags(vk::ImageCreateFlagBits())
 			 .setImageType(vk::ImageType::e2D)
-			 .setExtent(vk::Extent3D(width, height, 1))
+			 .setExtent(vk::Extent3D(data.width, data.height, 1))
 			 .setMipLevels(1)
 			 .setArrayLayers(1)
 			 .setFormat(vk::Format::eR8G8B8A8Unorm)
@@ -418,7 +542,8 @@ void Texture::LoadFile(std::string file_path)
 		 vk_command_buffer,
 		 vk_queue);
 
-	UploadPixelData(pixels, width * height * 4, vk::ImageLayout::eShaderReadOnlyOptimal);
+	channels = 4;
+	UploadPixelData(data.pixels.data(), data.pixels.size(), vk::ImageLayout::eShaderReadOnlyOptimal);
 }
 
 void Texture::CreateSampler(vk::SamplerCreateInfo sampler_info)
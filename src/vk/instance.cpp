@@ -101,6 +101,24 @@ void Instance::GetExtensions()
 #ifdef _DEBUG
 	extensions.push_back("VK_EXT_debug_utils");
 #endif
+
+	// Optional: the surface side of swapchain maintenance, which lets presents signal fences
+	std::vector<vk::ExtensionProperties> supported_extensions = vk::enumerateInstanceExtensionProperties();
+
+	auto supported = [&](const char* name)
+	{
+		for (const vk::ExtensionProperties& extension : supported_extensions)
+			if (strcmp(name, extension.extensionName.data()) == 0)
+				return true;
+		return false;
+	};
+	surface_maintenance = supported(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME)
+						  && supported(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+	if (surface_maintenance)
+	{
+		extensions.push_back(VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_SURFACE_MAINTENANCE_1_EXTENSION_NAME);
+	}
 }
 
 void Instance::GetLayers() 
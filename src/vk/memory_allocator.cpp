@@ -0,0 +1,136 @@
+#include "vk/memory_allocator.h"
+
+#include "vk/handler.h"
+
+#include <algorithm>
+
+namespace nft::vulkan
+{
+
+MemoryAllocator::MemoryAllocator(Device* device, vk::DeviceSize block_size): device(device), block_size(block_size)
+{
+	if (!device)
+		NFT_ERROR(VulkanFatal, "Device pointer is null in MemoryAllocator constructor.");
+
+	memory_properties = device->GetPhysicalDevice().getMemoryProperties();
+	pools.resize(memory_properties.memoryTypeCount * 2);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (auto& pool : pools)
+		for (auto& block : pool)
+			FreeDeviceMemory(block->memory, block->ranges.GetCapacity());
+	pools.clear();
+}
+
+MemoryAllocator::Allocation MemoryAllocator::Allocate(const vk::MemoryRequirements& requirements,
+													  uint32_t					   memory_type_index,
+													  bool						   linear)
+{
+	Allocation allocation;
+	allocation.size = requirements.size;
+
+	// Small heaps (integrated GPUs, host-visible device memory windows) get smaller blocks
+	uint32_t	   heap_index		 = memory_properties.memoryTypes[memory_type_index].heapIndex;
+	vk::DeviceSize heap_block_size = std::min(block_size, memory_properties.memoryHeaps[heap_index].size / 8);
+
+	if (requirements.size > heap_block_size / 2)
+	{
+		allocation.memory = AllocateDeviceMemory(requirements.size, memory_type_index, allocation.mapped);
+		stats.allocations++;
+		stats.used += requirements.size;
+		return allocation;
+	}
+
+	uint32_t pool_index = memory_type_index * 2 + (linear ? 1 : 0);
+	auto&	 pool		= pools[pool_index];
+
+	// The newest block is the most likely to have room
+	for (auto block = pool.rbegin(); block != pool.rend(); ++block)
+	{
+		TlsfAllocator::Allocation range = (*block)->ranges.Allocate(requirements.size, requirements.alignment);
+		if (range.node == TlsfAllocator::invalid)
+			continue;
+
+		allocation.memory = (*block)->memory;
+		allocation.offset = range.offset;
+		allocation.mapped = (*block)->mapped ? static_cast<char*>((*block)->mapped) + range.offset : nullptr;
+		allocation.block  = block->get();
+		allocation.node	  = range.node;
+		stats.allocations++;
+		stats.used += requirements.size;
+		return allocation;
+	}
+
+	void*			 mapped = nullptr;
+	vk::DeviceMemory memory = AllocateDeviceMemory(heap_block_size, memory_type_index, mapped);
+	pool.push_back(std::make_unique<Block>(Block { memory, mapped, TlsfAllocator(heap_block_size), pool_index }));
+
+	Block*					  block = pool.back().get();
+	TlsfAllocator::Allocation range = block->ranges.Allocate(requirements.size, requirements.alignment);
+	allocation.memory				= memory;
+	allocation.offset				= range.offset;
+	allocation.mapped				= mapped ? static_cast<char*>(mapped) + range.offset : nullptr;
+	allocation.block				= block;
+	allocation.node					= range.node;
+	stats.allocations++;
+	stats.used += requirements.size;
+	return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (!allocation.memory)
+		return;
+	stats.allocations--;
+	stats.used -= allocation.size;
+
+	if (!allocation.block)
+		FreeDeviceMemory(allocation.memory, allocation.size);
+	else
+	{
+		Block* block = allocation.block;
+		block->ranges.Free(allocation.node);
+
+		// Keep one block per set around, so a resource that comes and goes doesn't allocate every time
+		auto& pool = pools[block->pool];
+		if (block->ranges.IsEmpty() && pool.size() > 1)
+		{
+			FreeDeviceMemory(block->memory, block->ranges.GetCapacity());
+			std::erase_if(pool, [block](const std::unique_ptr<Block>& candidate) { return candidate.get() == block; });
+		}
+	}
+	allocation = {};
+}
+
+vk::DeviceMemory MemoryAllocator::AllocateDeviceMemory(vk::DeviceSize size, uint32_t memory_type_index, void*& mapped)
+{
+	vk::DeviceMemory memory;
+	try
+	{
+		memory = device->GetDevice().allocateMemory(
+			vk::MemoryAllocateInfo().setAllocationSize(size).setMemoryTypeIndex(memory_type_index));
+		mapped = nullptr;
+		if (memory_properties.memoryTypes[memory_type_index].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)
+			mapped = device->GetDevice().mapMemory(memory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
+	}
+	catch (const vk::SystemError& err)
+	{
+		NFT_ERROR(VulkanFatal, std::format("Failed To Allocate Device Memory ({} bytes):\n{}", size, err.what()));
+	}
+
+	stats.device_allocations++;
+	stats.reserved += size;
+	return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(vk::DeviceMemory memory, vk::DeviceSize size)
+{
+	// Freeing mapped memory unmaps it implicitly
+	device->GetDevice().freeMemory(memory);
+	stats.device_allocations--;
+	stats.reserved -= size;
+}
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,263 @@
+#include "vk/mesh_cache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+namespace nft::vulkan
+{
+
+static_assert(std::is_trivially_copyable_v<MeshCache::Header>);
+static_assert(std::is_trivially_copyable_v<MaterialRange>);
+static_assert(std::is_trivially_copyable_v<Meshlet>);
+static_assert(std::is_trivially_copyable_v<MeshLod>);
+static_assert(std::is_trivially_copyable_v<MeshCache::Dependency>);
+
+namespace
+{
+constexpr uint64_t section_alignment = 16;
+
+uint64_t Align(uint64_t offset)
+{
+	return (offset + section_alignment - 1) & ~(section_alignment - 1);
+}
+
+// 64-bit content hash, consuming eight bytes per step
+uint64_t HashBytes(const char* data, size_t size)
+{
+	constexpr uint64_t prime = 0x9E3779B97F4A7C15ull;
+
+	uint64_t hash = 0xCBF29CE484222325ull ^ size;
+	size_t	 pos  = 0;
+	for (; pos + 8 <= size; pos += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, data + pos, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 31;
+	}
+
+	uint64_t tail = 0;
+	if (pos < size)
+		std::memcpy(&tail, data + pos, size - pos);
+	hash = (hash ^ tail) * prime;
+	return hash ^ (hash >> 29);
+}
+
+template<typename T>
+bool IsSectionValid(const MappedFile& file, uint64_t offset, uint64_t count)
+{
+	return offset % alignof(T) == 0 && offset <= file.GetSize() && count <= (file.GetSize() - offset) / sizeof(T);
+}
+}	 // namespace
+
+std::string MeshCache::GetCachePath(const std::string& source_path)
+{
+	return std::filesystem::path(source_path).replace_extension(".nftmesh").string();
+}
+
+bool MeshCache::GetSourceInfo(const std::string& source_path, SourceInfo& info, bool hash_contents)
+{
+	std::error_code error;
+	info.size = std::filesystem::file_size(source_path, error);
+	if (error)
+		return false;
+
+	auto mtime = std::filesystem::last_write_time(source_path, error);
+	if (error)
+		return false;
+	info.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+
+	if (!hash_contents)
+		return true;
+
+	MappedFile source(source_path);
+	if (!source.IsOpen())
+		return false;
+	info.hash = HashBytes(source.GetData(), source.GetSize());
+	return true;
+}
+
+bool MeshCache::IsUnchanged(const std::string& path, uint64_t size, int64_t mtime, uint64_t hash)
+{
+	// Matching size and time are trusted; a new time alone (a touch or a checkout) is settled by the contents
+	SourceInfo info;
+	if (!GetSourceInfo(path, info, false) || info.size != size)
+		return false;
+	if (info.mtime == mtime)
+		return true;
+	return GetSourceInfo(path, info, true) && info.hash == hash;
+}
+
+std::shared_ptr<const MeshCache> MeshCache::Load(const std::string& source_path, uint32_t flags)
+{
+	auto cache = std::make_shared<MeshCache>();
+	if (!cache->file.Open(GetCachePath(source_path)) || cache->file.GetSize() < sizeof(Header))
+		return nullptr;
+
+	const Header* header = reinterpret_cast<const Header*>(cache->file.GetData());
+	if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version
+		|| header->vertex_stride != vertex_stride || header->flags != flags)
+		return nullptr;
+
+	if (!IsSectionValid<char>(cache->file, header->path_offset, header->path_size)
+		|| !IsSectionValid<float>(cache->file, header->vertex_offset, header->vertex_count * vertex_stride)
+		|| !IsSectionValid<uint32_t>(cache->file, header->index_offset, header->index_count)
+		|| !IsSectionValid<MaterialRange>(cache->file, header->material_range_offset, header->material_range_count)
+		|| !IsSectionValid<Meshlet>(cache->file, header->meshlet_offset, header->meshlet_count)
+		|| !IsSectionValid<MeshLod>(cache->file, header->lod_offset, header->lod_count)
+		|| !IsSectionValid<Dependency>(cache->file, header->dependency_offset, header->dependency_count))
+		return nullptr;
+
+	std::string_view cached_path(cache->file.GetData() + header->path_offset, header->path_size);
+	if (cached_path != source_path)
+		return nullptr;
+
+	if (!IsUnchanged(source_path, header->source_size, header->source_mtime, header->source_hash))
+		return nullptr;
+	for (const Dependency& dependency : cache->GetSection<Dependency>(header->dependency_offset, header->dependency_count))
+	{
+		if (!IsSectionValid<char>(cache->file, dependency.path_offset, dependency.path_size))
+			return nullptr;
+		std::string path(cache->file.GetData() + dependency.path_offset, dependency.path_size);
+		if (!IsUnchanged(path, dependency.size, dependency.mtime, dependency.hash))
+			return nullptr;
+	}
+
+	cache->header = header;
+	return cache;
+}
+
+bool MeshCache::Write(const std::string&			 source_path,
+					  uint32_t						 flags,
+					  std::span<const std::string>	 dependencies,
+					  std::span<const float>		 vertices,
+					  std::span<const uint32_t>		 indices,
+					  std::span<const MaterialRange> material_ranges,
+					  std::span<const Meshlet>		 meshlets,
+					  std::span<const MeshLod>		 lods,
+					  const Bounds&					 bounds)
+{
+	SourceInfo info;
+	if (!GetSourceInfo(source_path, info, true))
+		return false;
+
+	std::vector<Dependency> dependency_records(dependencies.size());
+	for (size_t i = 0; i < dependencies.size(); i++)
+	{
+		SourceInfo dependency_info;
+		if (!GetSourceInfo(dependencies[i], dependency_info, true))
+			return false;
+		dependency_records[i] = { dependency_info.size, dependency_info.mtime, dependency_info.hash, 0, dependencies[i].size() };
+	}
+
+	Header header = {};
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version		= version;
+	header.flags		= flags;
+	header.source_size	= info.size;
+	header.source_mtime = info.mtime;
+	header.source_hash	= info.hash;
+
+	header.vertex_stride		 = vertex_stride;
+	header.path_size			 = static_cast<uint32_t>(source_path.size());
+	header.path_offset			 = sizeof(Header);
+	header.vertex_count			 = vertices.size() / vertex_stride;
+	header.vertex_offset		 = Align(header.path_offset + header.path_size);
+	header.index_count			 = indices.size();
+	header.index_offset			 = Align(header.vertex_offset + vertices.size_bytes());
+	header.material_range_count	 = material_ranges.size();
+	header.material_range_offset = Align(header.index_offset + indices.size_bytes());
+	header.meshlet_count		 = meshlets.size();
+	header.meshlet_offset		 = Align(header.material_range_offset + material_ranges.size_bytes());
+	header.lod_count			 = lods.size();
+	header.lod_offset			 = Align(header.meshlet_offset + meshlets.size_bytes());
+	header.dependency_count		 = dependency_records.size();
+	header.dependency_offset	 = Align(header.lod_offset + lods.size_bytes());
+	std::memcpy(header.bounds_min, &bounds.min, sizeof(header.bounds_min));
+	std::memcpy(header.bounds_max, &bounds.max, sizeof(header.bounds_max));
+
+	// Dependency paths follow their records
+	uint64_t path_offset = header.dependency_offset + dependency_records.size() * sizeof(Dependency);
+	for (Dependency& dependency : dependency_records)
+	{
+		dependency.path_offset = path_offset;
+		path_offset += dependency.path_size;
+	}
+
+	// Write to a temporary file and swap it in, so a reader never maps a half-written cache
+	std::string cache_path = GetCachePath(source_path);
+	std::string temp_path  = cache_path + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			return false;
+
+		auto write_section = [&](uint64_t offset, const void* data, size_t size)
+		{
+			static constexpr char padding[section_alignment] = {};
+			file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+			file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		};
+
+		write_section(0, &header, sizeof(Header));
+		write_section(header.path_offset, source_path.data(), source_path.size());
+		write_section(header.vertex_offset, vertices.data(), vertices.size_bytes());
+		write_section(header.index_offset, indices.data(), indices.size_bytes());
+		write_section(header.material_range_offset, material_ranges.data(), material_ranges.size_bytes());
+		write_section(header.meshlet_offset, meshlets.data(), meshlets.size_bytes());
+		write_section(header.lod_offset, lods.data(), lods.size_bytes());
+		write_section(header.dependency_offset, dependency_records.data(), dependency_records.size() * sizeof(Dependency));
+		for (const std::string& dependency : dependencies)
+			file.write(dependency.data(), static_cast<std::streamsize>(dependency.size()));
+
+		if (!file.good())
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temp_path, cache_path, error);
+	if (error)
+	{
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+	return true;
+}
+
+std::span<const float> MeshCache::GetVertices() const
+{
+	return GetSection<float>(header->vertex_offset, header->vertex_count * vertex_stride);
+}
+
+std::span<const uint32_t> MeshCache::GetIndices() const
+{
+	return GetSection<uint32_t>(header->index_offset, header->index_count);
+}
+
+std::span<const MaterialRange> MeshCache::GetMaterialRanges() const
+{
+	return GetSection<MaterialRange>(header->material_range_offset, header->material_range_count);
+}
+
+std::span<const Meshlet> MeshCache::GetMeshlets() const
+{
+	return GetSection<Meshlet>(header->meshlet_offset, header->meshlet_count);
+}
+
+std::span<const MeshLod> MeshCache::GetLods() const
+{
+	return GetSection<MeshLod>(header->lod_offset, header->lod_count);
+}
+
+Bounds MeshCache::GetBounds() const
+{
+	Bounds bounds;
+	bounds.min = glm::vec3(header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]);
+	bounds.max = glm::vec3(header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]);
+	return bounds;
+}
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,358 @@
+#include "vk/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace nft::vulkan
+{
+
+namespace
+{
+// FIFO post-transform cache model. A vertex is a hit if fewer than size misses happened since it was
+// loaded; timestamps only grow, so one instance can be reused across ranges by calling Flush().
+struct FifoCache
+{
+	std::vector<uint32_t> load_time;
+	uint32_t			  size;
+	uint32_t			  timestamp;
+
+	FifoCache(size_t vertex_count, uint32_t size): load_time(vertex_count, 0), size(size), timestamp(size + 1) {}
+
+	bool Miss(uint32_t vertex)
+	{
+		if (timestamp - load_time[vertex] <= size)
+			return false;
+		load_time[vertex] = timestamp++;
+		return true;
+	}
+
+	void Flush() { timestamp += size + 1; }
+
+	float GetACMR(std::span<const uint32_t> indices)
+	{
+		if (indices.size() < 3)
+			return 0.0f;
+
+		Flush();
+		size_t misses = 0;
+		for (uint32_t vertex : indices)
+			misses += Miss(vertex) ? 1 : 0;
+		return float(misses) / float(indices.size() / 3);
+	}
+};
+
+//=========================================================================
+// VERTEX CACHE (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+//=========================================================================
+
+constexpr size_t max_cache_size	  = 32;	   // Modelled LRU cache size
+constexpr float cache_decay_power  = 1.5f;
+constexpr float last_triangle_score = 0.75f;	// Score of the three most recently used vertices
+constexpr float valence_boost_scale = 2.0f;
+constexpr float valence_boost_power = 0.5f;
+
+float GetVertexScore(int cache_position, uint32_t remaining_triangles)
+{
+	if (remaining_triangles == 0)
+		return -1.0f;	 // No triangle needs this vertex any more
+
+	float score = 0.0f;
+	if (cache_position >= 0)
+	{
+		if (cache_position < 3)
+			score = last_triangle_score;
+		else
+			score = std::pow(1.0f - float(cache_position - 3) / float(max_cache_size - 3), cache_decay_power);
+	}
+
+	// Favour vertices with few triangles left, so they are finished off and leave the cache early
+	return score + valence_boost_scale * std::pow(float(remaining_triangles), -valence_boost_power);
+}
+
+// Reorders the triangles of indices in place. local_ids must hold UINT32_MAX for every vertex on entry
+// and is restored before returning, so it can be shared between calls.
+void OptimizeVertexCacheRange(std::span<uint32_t> indices, std::vector<uint32_t>& local_ids)
+{
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count < 2)
+		return;
+
+	// Compact the range to local vertex ids so the per-vertex arrays only cover vertices it uses
+	std::vector<uint32_t> global_ids;
+	std::vector<uint32_t> local_indices(triangle_count * 3);
+	for (size_t i = 0; i < local_indices.size(); ++i)
+	{
+		uint32_t& local_id = local_ids[indices[i]];
+		if (local_id == UINT32_MAX)
+		{
+			local_id = uint32_t(global_ids.size());
+			global_ids.push_back(indices[i]);
+		}
+		local_indices[i] = local_id;
+	}
+	for (uint32_t global_id : global_ids)
+		local_ids[global_id] = UINT32_MAX;
+
+	size_t vertex_count = global_ids.size();
+
+	// Vertex -> triangle adjacency; the first remaining[v] entries of each list are the triangles not yet emitted
+	std::vector<uint32_t> remaining(vertex_count, 0);
+	for (uint32_t vertex : local_indices)
+		++remaining[vertex];
+
+	std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+	for (size_t v = 0; v < vertex_count; ++v)
+		adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining[v];
+
+	std::vector<uint32_t> adjacency(local_indices.size());
+	std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for (size_t i = 0; i < local_indices.size(); ++i)
+		adjacency[fill[local_indices[i]]++] = uint32_t(i / 3);
+
+	std::vector<int>   cache_positions(vertex_count, -1);
+	std::vector<float> vertex_scores(vertex_count);
+	for (size_t v = 0; v < vertex_count; ++v)
+		vertex_scores[v] = GetVertexScore(-1, remaining[v]);
+
+	std::vector<float> triangle_scores(triangle_count);
+	std::vector<bool>  emitted(triangle_count, false);
+	for (size_t t = 0; t < triangle_count; ++t)
+		triangle_scores[t] = vertex_scores[local_indices[t * 3]] + vertex_scores[local_indices[t * 3 + 1]]
+							 + vertex_scores[local_indices[t * 3 + 2]];
+
+	uint32_t best_triangle = uint32_t(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> new_cache;
+	cache.reserve(max_cache_size + 3);
+	new_cache.reserve(max_cache_size + 3);
+
+	size_t scan_cursor = 0;
+	for (size_t output = 0; output < triangle_count; ++output)
+	{
+		// Nothing in the cache has triangles left, so restart from the next triangle in input order
+		if (best_triangle == UINT32_MAX)
+		{
+			while (emitted[scan_cursor])
+				++scan_cursor;
+			best_triangle = uint32_t(scan_cursor);
+		}
+
+		const uint32_t* triangle = &local_indices[best_triangle * 3];
+		for (int corner = 0; corner < 3; ++corner)
+			indices[output * 3 + corner] = global_ids[triangle[corner]];
+		emitted[best_triangle] = true;
+
+		// Drop the triangle from its vertices' remaining lists
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uint32_t  vertex = triangle[corner];
+			uint32_t* list	 = &adjacency[adjacency_offsets[vertex]];
+			uint32_t* last	 = list + --remaining[vertex];
+			std::swap(*std::find(list, last + 1, best_triangle), *last);
+		}
+
+		// Move the triangle's vertices to the front of the cache
+		new_cache.assign(triangle, triangle + 3);
+		for (uint32_t vertex : cache)
+			if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+				new_cache.push_back(vertex);
+
+		// Rescore every vertex whose position changed, including the ones falling out of the cache
+		for (size_t i = 0; i < new_cache.size(); ++i)
+		{
+			uint32_t vertex			= new_cache[i];
+			cache_positions[vertex] = i < max_cache_size ? int(i) : -1;
+			vertex_scores[vertex]	= GetVertexScore(cache_positions[vertex], remaining[vertex]);
+		}
+		if (new_cache.size() > max_cache_size)
+			new_cache.resize(max_cache_size);
+		std::swap(cache, new_cache);
+
+		// Pick the best triangle that touches the cache
+		best_triangle	 = UINT32_MAX;
+		float best_score = -1.0f;
+		for (uint32_t vertex : cache)
+		{
+			for (uint32_t i = 0; i < remaining[vertex]; ++i)
+			{
+				uint32_t		t		   = adjacency[adjacency_offsets[vertex] + i];
+				const uint32_t* candidate  = &local_indices[t * 3];
+				triangle_scores[t]		   = vertex_scores[candidate[0]] + vertex_scores[candidate[1]] + vertex_scores[candidate[2]];
+				if (triangle_scores[t] > best_score)
+				{
+					best_score	  = triangle_scores[t];
+					best_triangle = t;
+				}
+			}
+		}
+	}
+}
+
+//=========================================================================
+// OVERDRAW
+//=========================================================================
+
+// Reorders cache-coherent clusters of triangles so the ones facing away from the mesh center, which are
+// the most likely occluders, are drawn first
+void OptimizeOverdrawRange(std::span<uint32_t> indices, std::span<const float> vertices, FifoCache& cache)
+{
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count < 2)
+		return;
+
+	auto position = [&](uint32_t vertex)
+	{
+		const float* data = &vertices[size_t(vertex) * MeshCache::vertex_stride];
+		return glm::vec3(data[0], data[1], data[2]);
+	};
+
+	// A triangle that misses the cache on all three vertices is where the cache optimizer restarted,
+	// so cutting clusters there costs (almost) no cache efficiency
+	std::vector<uint32_t> cluster_starts;
+	cache.Flush();
+	for (size_t t = 0; t < triangle_count; ++t)
+	{
+		int misses = 0;
+		for (int corner = 0; corner < 3; ++corner)
+			misses += cache.Miss(indices[t * 3 + corner]) ? 1 : 0;
+		if (t == 0 || misses == 3)
+			cluster_starts.push_back(uint32_t(t));
+	}
+	if (cluster_starts.size() < 2)
+		return;
+	cluster_starts.push_back(uint32_t(triangle_count));
+
+	size_t				   cluster_count = cluster_starts.size() - 1;
+	std::vector<glm::vec3> centroids(cluster_count, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(cluster_count, glm::vec3(0.0f));
+	glm::vec3			   mesh_centroid = glm::vec3(0.0f);
+	float				   mesh_area	 = 0.0f;
+
+	for (size_t c = 0; c < cluster_count; ++c)
+	{
+		float cluster_area = 0.0f;
+		for (uint32_t t = cluster_starts[c]; t < cluster_starts[c + 1]; ++t)
+		{
+			glm::vec3 p0 = position(indices[t * 3]);
+			glm::vec3 p1 = position(indices[t * 3 + 1]);
+			glm::vec3 p2 = position(indices[t * 3 + 2]);
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);	// Length is twice the area
+			float	  area	 = glm::length(normal);
+
+			centroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			normals[c] += normal;
+			cluster_area += area;
+		}
+
+		mesh_centroid += centroids[c];
+		mesh_area += cluster_area;
+		centroids[c] = cluster_area > 0.0f ? centroids[c] / cluster_area : position(indices[cluster_starts[c] * 3]);
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	std::vector<float> sort_keys(cluster_count);
+	for (size_t c = 0; c < cluster_count; ++c)
+	{
+		float length = glm::length(normals[c]);
+		sort_keys[c] = length > 0.0f ? glm::dot(centroids[c] - mesh_centroid, normals[c] / length) : 0.0f;
+	}
+
+	std::vector<uint32_t> order(cluster_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sort_keys[a] > sort_keys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (uint32_t c : order)
+		sorted.insert(sorted.end(), indices.begin() + cluster_starts[c] * 3, indices.begin() + cluster_starts[c + 1] * 3);
+	std::copy(sorted.begin(), sorted.end(), indices.begin());
+}
+}	 // namespace
+
+MeshOptimizer::Report MeshOptimizer::Optimize(std::vector<float>&				vertices,
+											  std::vector<uint32_t>&			indices,
+											  const std::vector<MaterialRange>& material_ranges,
+											  const Options&					options)
+{
+	size_t vertex_count = vertices.size() / MeshCache::vertex_stride;
+
+	Report report;
+	report.acmr_before = ComputeACMR(indices, vertex_count, options.cache_size);
+
+	std::vector<MaterialRange> ranges = material_ranges;
+	if (ranges.empty())
+		ranges.push_back({ 0, uint32_t(indices.size()), 0 });
+
+	std::vector<uint32_t> local_ids(vertex_count, UINT32_MAX);
+	std::vector<uint32_t> backup;
+	FifoCache			  cache(options.overdraw ? vertex_count : 0, options.cache_size);
+	for (const MaterialRange& range : ranges)
+	{
+		std::span<uint32_t> range_indices(indices.data() + range.first_index, range.index_count);
+
+		if (options.vertex_cache)
+			OptimizeVertexCacheRange(range_indices, local_ids);
+
+		if (options.overdraw)
+		{
+			float acmr = cache.GetACMR(range_indices);
+			backup.assign(range_indices.begin(), range_indices.end());
+
+			OptimizeOverdrawRange(range_indices, vertices, cache);
+			if (cache.GetACMR(range_indices) > acmr * options.overdraw_threshold)
+				std::copy(backup.begin(), backup.end(), range_indices.begin());
+		}
+	}
+
+	if (options.vertex_fetch)
+		OptimizeVertexFetch(vertices, indices);
+
+	report.acmr_after = ComputeACMR(indices, vertices.size() / MeshCache::vertex_stride, options.cache_size);
+	return report;
+}
+
+float MeshOptimizer::ComputeACMR(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size)
+{
+	FifoCache cache(vertex_count, cache_size);
+	return cache.GetACMR(indices);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertex_count)
+{
+	std::vector<uint32_t> local_ids(vertex_count, UINT32_MAX);
+	OptimizeVertexCacheRange(indices, local_ids);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const float> vertices, size_t vertex_count, uint32_t cache_size)
+{
+	FifoCache cache(vertex_count, cache_size);
+	OptimizeOverdrawRange(indices, vertices, cache);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<float>& vertices, std::span<uint32_t> indices)
+{
+	constexpr size_t stride = MeshCache::vertex_stride;
+
+	std::vector<uint32_t> remap(vertices.size() / stride, UINT32_MAX);
+	std::vector<float>	  fetched;
+	fetched.reserve(vertices.size());
+
+	// Unreferenced vertices are dropped
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = uint32_t(fetched.size() / stride);
+			fetched.insert(fetched.end(), vertices.begin() + size_t(index) * stride, vertices.begin() + size_t(index + 1) * stride);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(fetched);
+}
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,363 @@
+#include "vk/mesh_simplifier.h"
+
+#include "vk/mesh_optimizer.h"
+#include "vk/vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <tuple>
+
+namespace nft::vulkan
+{
+
+namespace
+{
+// Symmetric 4x4 error quadric, storing the upper triangle
+struct Quadric
+{
+	double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+	double a11 = 0, a12 = 0, a13 = 0;
+	double a22 = 0, a23 = 0;
+	double a33 = 0;
+
+	void AddPlane(double nx, double ny, double nz, double d)
+	{
+		a00 += nx * nx;
+		a01 += nx * ny;
+		a02 += nx * nz;
+		a03 += nx * d;
+		a11 += ny * ny;
+		a12 += ny * nz;
+		a13 += ny * d;
+		a22 += nz * nz;
+		a23 += nz * d;
+		a33 += d * d;
+	}
+
+	void Add(const Quadric& other)
+	{
+		a00 += other.a00;
+		a01 += other.a01;
+		a02 += other.a02;
+		a03 += other.a03;
+		a11 += other.a11;
+		a12 += other.a12;
+		a13 += other.a13;
+		a22 += other.a22;
+		a23 += other.a23;
+		a33 += other.a33;
+	}
+
+	// Sum of squared distances from p to the accumulated planes
+	double Evaluate(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x + a11 * y * y + 2 * a12 * y * z
+					 + 2 * a13 * y + a22 * z * z + 2 * a23 * z + a33;
+		return std::max(error, 0.0);
+	}
+};
+
+struct Collapse
+{
+	float	 cost;
+	uint32_t from;	  // Position ids
+	uint32_t to;
+	uint32_t from_version;
+	uint32_t to_version;
+
+	bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+glm::vec3 GetPosition(std::span<const float> vertices, uint32_t vertex)
+{
+	const float* data = vertices.data() + static_cast<size_t>(vertex) * MeshCache::vertex_stride;
+	return glm::vec3(data[0], data[1], data[2]);
+}
+
+// Squared distance of everything but the position (color, texture coordinates and normal)
+float GetAttributeDistance(std::span<const float> vertices, uint32_t a, uint32_t b)
+{
+	const float* pa		  = vertices.data() + static_cast<size_t>(a) * MeshCache::vertex_stride;
+	const float* pb		  = vertices.data() + static_cast<size_t>(b) * MeshCache::vertex_stride;
+	float		 distance = 0.0f;
+	for (size_t i = 3; i < MeshCache::vertex_stride; i++)
+		distance += (pa[i] - pb[i]) * (pa[i] - pb[i]);
+	return distance;
+}
+}	 // namespace
+
+std::vector<uint32_t> MeshSimplifier::Simplify(std::span<const float>	 vertices,
+											   std::span<const uint32_t> indices,
+											   size_t					 target_index_count,
+											   float					 max_error,
+											   float&					 result_error)
+{
+	result_error		  = 0.0f;
+	size_t vertex_count	  = vertices.size() / MeshCache::vertex_stride;
+	size_t triangle_count = indices.size() / 3;
+	if (triangle_count == 0 || indices.size() <= target_index_count)
+		return std::vector<uint32_t>(indices.begin(), indices.begin() + triangle_count * 3);
+
+	// Vertices that share a position (split by normals or texture seams) are one node of the topology
+	std::vector<uint32_t> sorted_vertices(vertex_count);
+	std::iota(sorted_vertices.begin(), sorted_vertices.end(), 0);
+	std::sort(sorted_vertices.begin(),
+			  sorted_vertices.end(),
+			  [&](uint32_t a, uint32_t b)
+			  {
+				  const float* pa = vertices.data() + static_cast<size_t>(a) * MeshCache::vertex_stride;
+				  const float* pb = vertices.data() + static_cast<size_t>(b) * MeshCache::vertex_stride;
+				  return std::tie(pa[0], pa[1], pa[2]) < std::tie(pb[0], pb[1], pb[2]);
+			  });
+
+	// The vertices of a position are sorted_vertices[position_starts[id]] up to the next position's start
+	std::vector<uint32_t>  position_ids(vertex_count);
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t>  position_starts;
+	for (size_t i = 0; i < vertex_count; i++)
+	{
+		glm::vec3 position = GetPosition(vertices, sorted_vertices[i]);
+		if (positions.empty() || !(positions.back() == position))
+		{
+			positions.push_back(position);
+			position_starts.push_back(static_cast<uint32_t>(i));
+		}
+		position_ids[sorted_vertices[i]] = static_cast<uint32_t>(positions.size() - 1);
+	}
+	size_t position_count = positions.size();
+	position_starts.push_back(static_cast<uint32_t>(vertex_count));
+
+	// A corner moved onto another position takes the vertex there that looks most like its own, which keeps
+	// flat shaded faces and either side of a texture seam apart
+	auto get_closest_vertex = [&](uint32_t vertex, uint32_t position_id)
+	{
+		uint32_t closest		  = sorted_vertices[position_starts[position_id]];
+		float	 closest_distance = GetAttributeDistance(vertices, vertex, closest);
+		for (uint32_t i = position_starts[position_id] + 1; i < position_starts[position_id + 1]; i++)
+		{
+			float distance = GetAttributeDistance(vertices, vertex, sorted_vertices[i]);
+			if (distance < closest_distance)
+			{
+				closest			 = sorted_vertices[i];
+				closest_distance = distance;
+			}
+		}
+		return closest;
+	};
+
+	std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangle_count * 3);
+	std::vector<bool>	  removed_triangles(triangle_count, false);
+	size_t				  live_triangles = triangle_count;
+
+	auto get_position_id = [&](size_t triangle, uint32_t corner) { return position_ids[triangles[triangle * 3 + corner]]; };
+
+	// Lock borders and non-manifold edges (any edge not shared by exactly two triangles). Attribute seams aren't
+	// edges of this topology, so seam and flat shaded vertices collapse like any other.
+	std::vector<bool>	  locked(position_count, false);
+	std::vector<uint64_t> edges;
+	edges.reserve(triangle_count * 3);
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t a = get_position_id(t, corner);
+			uint32_t b = get_position_id(t, (corner + 1) % 3);
+			if (a != b)
+				edges.push_back((uint64_t(std::min(a, b)) << 32) | std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t run = i;
+		while (run < edges.size() && edges[run] == edges[i])
+			run++;
+		if (run - i != 2)
+		{
+			locked[edges[i] >> 32]		   = true;
+			locked[edges[i] & 0xFFFFFFFFu] = true;
+		}
+		i = run;
+	}
+
+	// Plane quadrics and triangle adjacency per position
+	std::vector<Quadric>			   quadrics(position_count);
+	std::vector<std::vector<uint32_t>> position_triangles(position_count);
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		uint32_t  ids[3] = { get_position_id(t, 0), get_position_id(t, 1), get_position_id(t, 2) };
+		glm::vec3 normal = glm::cross(positions[ids[1]] - positions[ids[0]], positions[ids[2]] - positions[ids[0]]);
+		float	  length = glm::length(normal);
+		if (length > 0.0f)
+		{
+			normal /= length;
+			double d = -glm::dot(normal, positions[ids[0]]);
+			for (uint32_t id : ids)
+				quadrics[id].AddPlane(normal.x, normal.y, normal.z, d);
+		}
+		for (uint32_t corner = 0; corner < 3; corner++)
+			if (corner == 0 || ids[corner] != ids[corner - 1])
+				position_triangles[ids[corner]].push_back(static_cast<uint32_t>(t));
+	}
+
+	std::vector<uint32_t> versions(position_count, 0);
+	std::vector<bool>	  removed_positions(position_count, false);
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+	auto push_collapse = [&](uint32_t from, uint32_t to)
+	{
+		if (locked[from] || from == to)
+			return;
+		Quadric quadric = quadrics[from];
+		quadric.Add(quadrics[to]);
+		queue.push({ static_cast<float>(quadric.Evaluate(positions[to])), from, to, versions[from], versions[to] });
+	};
+
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	for (uint64_t edge : edges)
+	{
+		push_collapse(static_cast<uint32_t>(edge >> 32), static_cast<uint32_t>(edge));
+		push_collapse(static_cast<uint32_t>(edge), static_cast<uint32_t>(edge >> 32));
+	}
+
+	double				  max_cost	= double(max_error) * double(max_error);
+	double				  used_cost = 0.0;
+	std::vector<uint32_t> neighbours;
+	while (live_triangles * 3 > target_index_count && !queue.empty())
+	{
+		Collapse collapse = queue.top();
+		queue.pop();
+
+		if (removed_positions[collapse.from] || removed_positions[collapse.to] || versions[collapse.from] != collapse.from_version
+			|| versions[collapse.to] != collapse.to_version)
+			continue;
+		if (collapse.cost > max_cost)
+			break;
+
+		bool flips = false;
+		for (uint32_t t : position_triangles[collapse.from])
+		{
+			if (removed_triangles[t])
+				continue;
+
+			int	 from_corner = -1;
+			bool has_to		 = false;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t id = get_position_id(t, corner);
+				if (id == collapse.from)
+					from_corner = corner;
+				else if (id == collapse.to)
+					has_to = true;
+			}
+
+			// Triangles on the collapsing edge disappear
+			if (has_to)
+				continue;
+
+			// Reject collapses that would fold a neighbouring triangle over
+			glm::vec3 p[3] = { positions[get_position_id(t, 0)], positions[get_position_id(t, 1)], positions[get_position_id(t, 2)] };
+			glm::vec3 normal_before = glm::cross(p[1] - p[0], p[2] - p[0]);
+			p[from_corner]			= positions[collapse.to];
+			glm::vec3 normal_after	= glm::cross(p[1] - p[0], p[2] - p[0]);
+			if (glm::dot(normal_before, normal_after) <= 0.0f)
+			{
+				flips = true;
+				break;
+			}
+		}
+		if (flips)
+			continue;
+
+		for (uint32_t t : position_triangles[collapse.from])
+		{
+			if (removed_triangles[t])
+				continue;
+
+			bool has_to = false;
+			for (uint32_t corner = 0; corner < 3; corner++)
+				has_to = has_to || get_position_id(t, corner) == collapse.to;
+
+			if (has_to)
+			{
+				removed_triangles[t] = true;
+				live_triangles--;
+				continue;
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++)
+				if (get_position_id(t, corner) == collapse.from)
+					triangles[t * 3 + corner] = get_closest_vertex(triangles[t * 3 + corner], collapse.to);
+			position_triangles[collapse.to].push_back(t);
+		}
+
+		quadrics[collapse.to].Add(quadrics[collapse.from]);
+		removed_positions[collapse.from] = true;
+		position_triangles[collapse.from].clear();
+		position_triangles[collapse.from].shrink_to_fit();
+		versions[collapse.to]++;
+		used_cost = std::max(used_cost, double(collapse.cost));
+
+		// Drop dead triangles from the surviving fan and requeue its edges with the merged quadric
+		std::vector<uint32_t>& fan = position_triangles[collapse.to];
+		fan.erase(std::remove_if(fan.begin(), fan.end(), [&](uint32_t t) { return removed_triangles[t]; }), fan.end());
+
+		neighbours.clear();
+		for (uint32_t t : fan)
+			for (uint32_t corner = 0; corner < 3; corner++)
+				neighbours.push_back(get_position_id(t, corner));
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+		for (uint32_t id : neighbours)
+		{
+			push_collapse(collapse.to, id);
+			push_collapse(id, collapse.to);
+		}
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(live_triangles * 3);
+	for (size_t t = 0; t < triangle_count; t++)
+		if (!removed_triangles[t])
+			result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+
+	result_error = static_cast<float>(std::sqrt(used_cost));
+	return result;
+}
+
+std::vector<MeshLod> MeshSimplifier::BuildLodChain(std::span<const float> vertices, std::vector<uint32_t>& indices, uint32_t level_count)
+{
+	std::vector<MeshLod> lods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+
+	Bounds bounds	 = ComputeBounds(vertices);
+	float  max_error = glm::length(bounds.max - bounds.min) * max_relative_error;
+	size_t vertex_count = vertices.size() / MeshCache::vertex_stride;
+
+	std::vector<uint32_t> source(indices);
+	for (uint32_t level = 1; level < level_count; level++)
+	{
+		size_t target_index_count = static_cast<size_t>(source.size() / 3 * level_reduction) * 3;
+		if (target_index_count < min_triangles * 3)
+			break;
+
+		// Every level simplifies the previous one, so errors add up along the chain
+		float				  error		 = 0.0f;
+		std::vector<uint32_t> simplified = Simplify(vertices, source, target_index_count, max_error - lods.back().error, error);
+		if (simplified.empty() || simplified.size() > source.size() * 9 / 10)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(simplified, vertex_count);
+
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), lods.back().error + error });
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		source = std::move(simplified);
+	}
+
+	return lods;
+}
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,210 @@
+#include "vk/meshlet.h"
+
+#include "vk/frustum_culler.h"
+
+#include <algorithm>
+
+namespace nft::vulkan
+{
+
+namespace
+{
+constexpr float never_cone_culled = 2.0f;	 // Cone cutoff that no view direction can reach
+
+glm::vec3 GetPosition(std::span<const float> vertices, uint32_t vertex)
+{
+	const float* data = vertices.data() + static_cast<size_t>(vertex) * MeshCache::vertex_stride;
+	return glm::vec3(data[0], data[1], data[2]);
+}
+
+Meshlet MakeMeshlet(std::span<const float>	  vertices,
+					std::span<const uint32_t> indices,
+					uint32_t				  first_index,
+					uint32_t				  index_count,
+					std::span<const uint32_t> local_vertices)
+{
+	Meshlet meshlet		 = {};
+	meshlet.first_index	 = first_index;
+	meshlet.index_count	 = index_count;
+	meshlet.vertex_count = static_cast<uint32_t>(local_vertices.size());
+	meshlet.cone_cutoff	 = never_cone_culled;
+	if (local_vertices.empty())
+		return meshlet;
+
+	// Bounding sphere around the center of the cluster's box
+	glm::vec3 min = GetPosition(vertices, local_vertices[0]);
+	glm::vec3 max = min;
+	for (uint32_t vertex : local_vertices)
+	{
+		min = glm::min(min, GetPosition(vertices, vertex));
+		max = glm::max(max, GetPosition(vertices, vertex));
+	}
+	meshlet.center = (min + max) * 0.5f;
+	for (uint32_t vertex : local_vertices)
+		meshlet.radius = std::max(meshlet.radius, glm::length(GetPosition(vertices, vertex) - meshlet.center));
+
+	// Normal cone from the face normals; degenerate triangles face nowhere and are ignored
+	glm::vec3 normals[MeshletBuilder::max_triangles];
+	uint32_t  normal_count = 0;
+	glm::vec3 normal_sum(0.0f);
+	size_t	  vertex_count = vertices.size() / MeshCache::vertex_stride;
+	for (uint32_t i = first_index; i + 2 < first_index + index_count; i += 3)
+	{
+		if (indices[i] >= vertex_count || indices[i + 1] >= vertex_count || indices[i + 2] >= vertex_count)
+			continue;
+
+		glm::vec3 a		 = GetPosition(vertices, indices[i]);
+		glm::vec3 normal = glm::cross(GetPosition(vertices, indices[i + 1]) - a, GetPosition(vertices, indices[i + 2]) - a);
+		float	  length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+
+		normals[normal_count++] = normal / length;
+		normal_sum += normal / length;
+	}
+
+	float axis_length = glm::length(normal_sum);
+	if (normal_count == 0 || axis_length < 1e-6f)
+		return meshlet;
+	meshlet.cone_axis = normal_sum / axis_length;
+
+	float min_dot = 1.0f;
+	for (uint32_t i = 0; i < normal_count; i++)
+		min_dot = std::min(min_dot, glm::dot(normals[i], meshlet.cone_axis));
+
+	// A spread of 90 degrees or more always has some triangle facing the camera
+	if (min_dot > 0.0f)
+		meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+	return meshlet;
+}
+}	 // namespace
+
+std::vector<Meshlet> MeshletBuilder::Build(std::span<const float>		  vertices,
+										   std::span<const uint32_t>	  indices,
+										   std::span<const MaterialRange> material_ranges)
+{
+	std::vector<Meshlet> meshlets;
+	size_t				 vertex_count = vertices.size() / MeshCache::vertex_stride;
+	if (indices.size() < 3 || vertex_count == 0)
+		return meshlets;
+
+	MaterialRange whole_mesh = { 0, static_cast<uint32_t>(indices.size()), 0 };
+	if (material_ranges.empty())
+		material_ranges = std::span<const MaterialRange>(&whole_mesh, 1);
+
+	// Meshlet that last referenced each vertex, so counting a cluster's unique vertices is O(1) per corner
+	std::vector<uint32_t> vertex_meshlet(vertex_count, UINT32_MAX);
+	std::vector<uint32_t> local_vertices;
+	local_vertices.reserve(max_vertices);
+	meshlets.reserve(indices.size() / (3 * max_triangles / 2) + material_ranges.size());
+
+	for (const MaterialRange& range : material_ranges)
+	{
+		uint32_t first = std::min<uint32_t>(range.first_index, static_cast<uint32_t>(indices.size()));
+		uint32_t end   = std::min<uint32_t>(first + range.index_count, static_cast<uint32_t>(indices.size()));
+		end			   = first + (end - first) / 3 * 3;
+
+		uint32_t meshlet_id	   = static_cast<uint32_t>(meshlets.size());
+		uint32_t meshlet_first = first;
+		local_vertices.clear();
+
+		for (uint32_t i = first; i < end; i += 3)
+		{
+			const uint32_t* triangle = indices.data() + i;
+			if (triangle[0] >= vertex_count || triangle[1] >= vertex_count || triangle[2] >= vertex_count)
+				continue;
+
+			uint32_t new_vertices = 0;
+			for (uint32_t corner = 0; corner < 3; corner++)
+				new_vertices += vertex_meshlet[triangle[corner]] != meshlet_id ? 1 : 0;
+
+			if (local_vertices.size() + new_vertices > max_vertices || (i - meshlet_first) / 3 >= max_triangles)
+			{
+				meshlets.push_back(MakeMeshlet(vertices, indices, meshlet_first, i - meshlet_first, local_vertices));
+				meshlet_id	  = static_cast<uint32_t>(meshlets.size());
+				meshlet_first = i;
+				local_vertices.clear();
+			}
+
+			for (uint32_t corner = 0; corner < 3; corner++)
+			{
+				if (vertex_meshlet[triangle[corner]] == meshlet_id)
+					continue;
+				vertex_meshlet[triangle[corner]] = meshlet_id;
+				local_vertices.push_back(triangle[corner]);
+			}
+		}
+
+		if (end > meshlet_first)
+			meshlets.push_back(MakeMeshlet(vertices, indices, meshlet_first, end - meshlet_first, local_vertices));
+	}
+
+	return meshlets;
+}
+
+void MeshletCuller::SetView(const glm::mat4& view_proj, const glm::vec3& camera_position)
+{
+	this->camera_position = camera_position;
+
+	ExtractFrustumPlanes(view_proj, frustum_planes);
+}
+
+void MeshletCuller::Cull(std::span<const Meshlet> meshlets, const glm::mat4& transform, std::vector<IndexRange>& ranges)
+{
+	ranges.clear();
+	stats.meshlets += static_cast<uint32_t>(meshlets.size());
+
+	auto append = [&ranges](const Meshlet& meshlet)
+	{
+		if (!ranges.empty() && ranges.back().first_index + ranges.back().index_count == meshlet.first_index)
+			ranges.back().index_count += meshlet.index_count;
+		else
+			ranges.push_back({ meshlet.first_index, meshlet.index_count });
+	};
+
+	if (meshlets.size() < options.min_meshlets)
+	{
+		for (const Meshlet& meshlet : meshlets)
+			append(meshlet);
+		return;
+	}
+
+	// Spheres go to world space for the frustum test (scaled by the largest axis, so they stay conservative);
+	// the camera goes to model space for the cone test, where the meshlet normals live
+	float max_scale = std::sqrt(std::max({ glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+										   glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+										   glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])) }));
+	glm::vec3 model_camera = glm::vec3(glm::inverse(transform) * glm::vec4(camera_position, 1.0f));
+
+	for (const Meshlet& meshlet : meshlets)
+	{
+		if (options.frustum)
+		{
+			glm::vec3 center = glm::vec3(transform * glm::vec4(meshlet.center, 1.0f));
+			float	  radius = meshlet.radius * max_scale;
+
+			bool outside = false;
+			for (const glm::vec4& plane : frustum_planes)
+				outside = outside || glm::dot(glm::vec3(plane), center) + plane.w < -radius;
+			if (outside)
+			{
+				stats.frustum_culled++;
+				continue;
+			}
+		}
+
+		if (options.cone)
+		{
+			glm::vec3 view = meshlet.center - model_camera;
+			if (glm::dot(view, meshlet.cone_axis) >= meshlet.cone_cutoff * glm::length(view) + meshlet.radius)
+			{
+				stats.cone_culled++;
+				continue;
+			}
+		}
+
+		append(meshlet);
+	}
+}
+
+}	 // namespace nft::vulkan
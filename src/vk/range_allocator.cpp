@@ -0,0 +1,119 @@
+#include "vk/range_allocator.h"
+
+namespace nft::vulkan
+{
+
+RangeAllocator::RangeAllocator(size_t capacity)
+{
+	Grow(capacity);
+}
+
+size_t RangeAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+		return invalid;
+	if (alignment == 0)
+		alignment = 1;
+
+	// Smallest ranges first; alignment padding can make one that is large enough still miss
+	for (auto candidate = free_by_size.lower_bound({ size, 0 }); candidate != free_by_size.end(); ++candidate)
+	{
+		auto [range_size, range_offset] = *candidate;
+		size_t offset					= (range_offset + alignment - 1) / alignment * alignment;
+		if (offset + size > range_offset + range_size)
+			continue;
+
+		Take(free_ranges.find(range_offset), offset, size);
+		return offset;
+	}
+	return invalid;
+}
+
+size_t RangeAllocator::AllocateBelow(size_t size, size_t alignment, size_t limit)
+{
+	if (size == 0)
+		return invalid;
+	if (alignment == 0)
+		alignment = 1;
+
+	for (auto range = free_ranges.begin(); range != free_ranges.end() && range->first < limit; ++range)
+	{
+		size_t offset = (range->first + alignment - 1) / alignment * alignment;
+		if (offset + size > range->first + range->second || offset + size > limit)
+			continue;
+
+		Take(range, offset, size);
+		return offset;
+	}
+	return invalid;
+}
+
+void RangeAllocator::Free(size_t offset, size_t size)
+{
+	if (size == 0)
+		return;
+	used -= size;
+	change_count++;
+
+	// Merge with the free ranges directly before and after
+	auto next = free_ranges.lower_bound(offset);
+	if (next != free_ranges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		RemoveFree(next);
+	}
+
+	auto previous = free_ranges.lower_bound(offset);
+	if (previous != free_ranges.begin())
+	{
+		--previous;
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFree(previous);
+		}
+	}
+
+	AddFree(offset, size);
+}
+
+void RangeAllocator::Grow(size_t new_capacity)
+{
+	if (new_capacity <= capacity)
+		return;
+
+	size_t added = new_capacity - capacity;
+	size_t start = capacity;
+	capacity	 = new_capacity;
+
+	// Free() does the merging, and the space isn't counted as used to begin with
+	used += added;
+	Free(start, added);
+}
+
+void RangeAllocator::AddFree(size_t offset, size_t size)
+{
+	free_ranges.emplace(offset, size);
+	free_by_size.emplace(size, offset);
+}
+
+void RangeAllocator::Take(std::map<size_t, size_t>::iterator range, size_t offset, size_t size)
+{
+	auto [range_offset, range_size] = *range;
+	RemoveFree(range);
+	if (offset > range_offset)
+		AddFree(range_offset, offset - range_offset);
+	if (offset + size < range_offset + range_size)
+		AddFree(offset + size, range_offset + range_size - offset - size);
+	used += size;
+	change_count++;
+}
+
+void RangeAllocator::RemoveFree(std::map<size_t, size_t>::iterator range)
+{
+	free_by_size.erase({ range->second, range->first });
+	free_ranges.erase(range);
+}
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,94 @@
+#include "vk/render_queue.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace nft::vulkan
+{
+
+namespace
+{
+constexpr uint32_t radix_bits = 8;
+constexpr uint32_t radix_size = 1 << radix_bits;
+constexpr uint32_t pass_count = 64 / radix_bits;
+
+uint64_t Field(uint64_t value, uint32_t bits, uint32_t shift)
+{
+	return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+}	 // namespace
+
+uint64_t RenderQueue::MakeKey(uint32_t pipeline, uint32_t index_type, uint32_t mesh, uint32_t level, float depth, uint32_t material)
+{
+	// Non-negative floats order like their bit patterns; the top bits keep the exponent and leading mantissa
+	uint32_t depth_key = std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> (32 - depth_bits);
+	level			   = std::min(level, (1u << level_bits) - 1);
+
+	uint32_t shift = 0;
+	uint64_t key   = Field(depth_key, depth_bits, shift);
+	key |= Field(material, material_bits, shift += depth_bits);
+	key |= Field(level, level_bits, shift += material_bits);
+	key |= Field(mesh, mesh_bits, shift += level_bits);
+	key |= Field(index_type, index_type_bits, shift += mesh_bits);
+	key |= Field(pipeline, pipeline_bits, shift += index_type_bits);
+	return key;
+}
+
+void RenderQueue::Clear()
+{
+	entries.clear();
+	state_bound.fill(false);
+	stats = {};
+}
+
+void RenderQueue::Sort()
+{
+	stats.draws = static_cast<uint32_t>(entries.size());
+	if (entries.size() < 2)
+		return;
+
+	// Least significant digit first; all digit histograms are gathered in one pass over the keys
+	std::array<std::array<uint32_t, radix_size>, pass_count> histograms {};
+	for (const Entry& entry : entries)
+		for (uint32_t pass = 0; pass < pass_count; ++pass)
+			histograms[pass][(entry.key >> (pass * radix_bits)) & (radix_size - 1)]++;
+
+	scratch.resize(entries.size());
+	for (uint32_t pass = 0; pass < pass_count; ++pass)
+	{
+		// Digits every key shares, like unused pipeline bits, leave the order as it is
+		std::array<uint32_t, radix_size>& histogram = histograms[pass];
+		uint32_t							shift	  = pass * radix_bits;
+		if (histogram[(entries[0].key >> shift) & (radix_size - 1)] == entries.size())
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& count : histogram)
+		{
+			uint32_t digit_count = count;
+			count				 = offset;
+			offset += digit_count;
+		}
+
+		for (const Entry& entry : entries)
+			scratch[histogram[(entry.key >> shift) & (radix_size - 1)]++] = entry;
+		entries.swap(scratch);
+	}
+}
+
+bool RenderQueue::NeedsBind(State state, uint32_t value)
+{
+	size_t slot = static_cast<size_t>(state);
+	if (state_bound[slot] && bound_state[slot] == value)
+	{
+		stats.binds_skipped++;
+		return false;
+	}
+
+	state_bound[slot] = true;
+	bound_state[slot] = value;
+	stats.binds++;
+	return true;
+}
+
+}	 // namespace nft::vulkan
@@ -2,35 +2,75 @@
 
 #include "gui/window.h"
 #include "vk/handler.h"
+#include "vk/upload_scheduler.h"
 
 namespace nft::vulkan
 {
+namespace
+{
+// Grey unit cube shown in place of meshes that are still loading
+SimpleMesh* CreatePlaceholderMesh()
+{
+	std::vector<float>	  vertices;
+	std::vector<uint32_t> indices;
+	vertices.reserve(24 * MeshCache::vertex_stride);
+	indices.reserve(36);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (float side : { -1.0f, 1.0f })
+		{
+			glm::vec3 normal(0.0f);
+			normal[axis] = side;
+			glm::vec3 u(0.0f), v(0.0f);
+			u[(axis + 1) % 3] = 1.0f;
+			v[(axis + 2) % 3] = side;	 // Flipped with the side so every face winds outwards
+
+			uint32_t first = static_cast<uint32_t>(vertices.size() / MeshCache::vertex_stride);
+			for (glm::vec2 corner : { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) })
+			{
+				glm::vec3 position = (normal + u * (corner.x * 2.0f - 1.0f) + v * (corner.y * 2.0f - 1.0f)) * 0.5f;
+				vertices.insert(vertices.end(),
+								{ position.x, position.y, position.z, 0.5f, 0.5f, 0.5f, 1.0f, corner.x, corner.y, normal.x, normal.y, normal.z });
+			}
+			indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+	}
+
+	return new SimpleMesh(std::move(vertices), std::move(indices));
+}
+}	 // namespace
+
 Scene::Scene(Surface* surface, vk::CommandBuffer main_command_buffer):
 	Observer(surface->window->event_handler.get()), surface(surface), device(surface->device)
 {
 	if (!device)
 		NFT_ERROR(VulkanFatal, "Device Is Null!");
-	geometry_batcher = std::make_unique<GeometryBatcher>(device);
+	geometry_batcher	  = std::make_unique<GeometryBatcher>(device);
+	asset_loader		  = std::make_unique<AssetLoader>();
+	upload_command_buffer = main_command_buffer;
 
-	meshes.resize(1, new SimpleMesh());
+	// Everything starts out as a placeholder, so the first frame never waits on file I/O
+	meshes.push_back(CreatePlaceholderMesh());
+	geometry_batcher->AddGeometry(meshes[0]);
 
 	Subscribe<KeyEvent>();
 	Subscribe<MouseButtonEvent>();
 	Subscribe<MouseMoveEvent>();
 
 	ObjectData loaded_object;
-	loaded_object.mesh = meshes[0];
-	loaded_object.mesh->LoadObj("./assets/models", "monkey.obj");
+	loaded_object.mesh			 = meshes[0];
 	loaded_object.transform		 = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, -3.0f));
 	loaded_object.transform		 = glm::rotate(loaded_object.transform, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	loaded_object.material_index = 0;	 // Use the first material
 	objects.push_back(loaded_object);
-	geometry_batcher->AddGeometry(loaded_object.mesh);
+	StreamMesh(objects.size() - 1, "./assets/models", "monkey.obj");
 
 	// Load multiple textures for demonstration
+	TextureData placeholder_texture = { 1, 1, { 255, 255, 255, 255 } };
 	textures.push_back(Texture(device));
 	textures[0].SetupCommands(main_command_buffer, device->vk_graphics_queue);
-	textures[0].LoadFile("./assets/textures/default.png");
+	textures[0].Upload(placeholder_texture);
 	textures[0].CreateSampler(vk::SamplerCreateInfo()
 								  .setMagFilter(vk::Filter::eLinear)
 								  .setMinFilter(vk::Filter::eLinear)
@@ -45,6 +85,7 @@ Scene::Scene(Surface* surface, vk::CommandBuffer main_command_buffer):
 								  .setCompareOp(vk::CompareOp::eAlways)
 								  .setMipmapMode(vk::SamplerMipmapMode::eLinear)
 								  .setMipLodBias(0.0f));
+	StreamTexture(0, "./assets/textures/default.png");
 
 	//// Try to load additional textures if they exist (for demonstration)
 	//// In a real application, you'd load these from your material definitions
@@ -95,12 +136,56 @@ Scene::Scene(Surface* surface, vk::CommandBuffer main_command_buffer):
 		UINT32_MAX						// specular_texture_index - no specular texture
 	};
 
-	materials.push_back(default_material);
-	materials.push_back(default_textured_material);
+	AddMaterial(default_material);
+	AddMaterial(default_textured_material);
 	camera_transforms = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
 	UpdateCameraFromOrbit();
 
-	geometry_batcher->CreateBuffers(main_command_buffer, device->vk_graphics_queue);
+	geometry_batcher->Upload(main_command_buffer, device->vk_graphics_queue);
+}
+
+size_t Scene::ProcessLoadedAssets(size_t max_count)
+{
+	return asset_loader->ProcessCompleted(max_count);
+}
+
+void Scene::StreamMesh(size_t object_index, const std::string& file_dir, const std::string& file_name)
+{
+	asset_loader->LoadMesh(file_dir,
+						   file_name,
+						   {},
+						   [this, object_index, file_name](std::shared_ptr<IMesh> mesh)
+						   {
+							   if (object_index >= objects.size())
+								   return;
+
+							   streamed_meshes.push_back(mesh);
+							   meshes.push_back(mesh.get());
+							   geometry_batcher->AddGeometry(mesh.get());
+							   geometry_batcher->Upload(upload_command_buffer, device->vk_graphics_queue);
+							   objects[object_index].mesh = mesh.get();
+
+							   VulkanHandler::app->GetLogger()->Debug(std::format("Streamed in mesh \"{}\"", file_name), "VKInit");
+						   });
+}
+
+void Scene::StreamTexture(size_t texture_index, const std::string& file_path)
+{
+	asset_loader->LoadTexture(file_path,
+							  [this, texture_index, file_path](std::shared_ptr<TextureData> data)
+							  {
+								  if (texture_index >= textures.size())
+									  return;
+
+								  // The old image goes right away, and the descriptors naming it are rewritten, so
+								  // neither frames nor earlier uploads into it may still be running
+								  device->vk_graphics_queue.waitIdle();
+								  device->GetUploadScheduler()->WaitIdle();
+								  textures[texture_index].Upload(*data);
+								  textures_version++;
+								  VulkanHandler::app->GetLogger()->Debug(
+									  std::format("Streamed in texture \"{}\" ({}x{})", file_path, data->width, data->height), "VKInit");
+							  });
 }
 
 void Scene::UpdateCameraFromOrbit()
@@ -283,19 +368,49 @@ void Scene::Update(IEvent* source)
 	}
 }
 
-vk::VertexInputBindingDescription GetVertexInputBindingDescription()
+vk::VertexInputBindingDescription GetVertexInputBindingDescription(VertexFormat format)
 {
 	vk::VertexInputBindingDescription binding_description;
 	binding_description.binding	  = 0;								 // Binding index
-	binding_description.stride	  = 12 * sizeof(float);				 // Size of each vertex
+	binding_description.stride	  = GetVertexSize(format);			 // Size of each vertex
 	binding_description.inputRate = vk::VertexInputRate::eVertex;	 // Per-vertex data
 	return binding_description;
 }
 
-std::vector<vk::VertexInputAttributeDescription> GetVertexInputAttributeDescriptions()
+std::vector<vk::VertexInputAttributeDescription> GetVertexInputAttributeDescriptions(VertexFormat format)
 {
 	std::vector<vk::VertexInputAttributeDescription> attribute_descriptions;
 	attribute_descriptions.reserve(4);
+
+	if (format == VertexFormat::Compact)
+	{
+		// Position attribute, quantized to the mesh bounds (dequantized by the object transform)
+		attribute_descriptions.push_back(vk::VertexInputAttributeDescription()
+											 .setBinding(0)
+											 .setLocation(0)
+											 .setFormat(vk::Format::eR16G16B16A16Unorm)
+											 .setOffset(offsetof(CompactVertex, position_xy)));
+		// Color attribute
+		attribute_descriptions.push_back(vk::VertexInputAttributeDescription()
+											 .setBinding(0)
+											 .setLocation(1)
+											 .setFormat(vk::Format::eR8G8B8A8Unorm)
+											 .setOffset(offsetof(CompactVertex, color)));
+		// Texture Coordinate attribute
+		attribute_descriptions.push_back(vk::VertexInputAttributeDescription()
+											 .setBinding(0)
+											 .setLocation(2)
+											 .setFormat(vk::Format::eR16G16Sfloat)
+											 .setOffset(offsetof(CompactVertex, texture_coord)));
+		// Normal attribute, octahedral encoded (decoded in the vertex shader)
+		attribute_descriptions.push_back(vk::VertexInputAttributeDescription()
+											 .setBinding(0)
+											 .setLocation(3)
+											 .setFormat(vk::Format::eR16G16Snorm)
+											 .setOffset(offsetof(CompactVertex, normal)));
+		return attribute_descriptions;
+	}
+
 	// Position attribute
 	attribute_descriptions.push_back(
 		vk::VertexInputAttributeDescription().setBinding(0).setLocation(0).setFormat(vk::Format::eR32G32B32Sfloat).setOffset(0));
@@ -0,0 +1,104 @@
+#include "vk/staging_ring.h"
+
+#include "vk/handler.h"
+
+namespace nft::vulkan
+{
+
+StagingRing::StagingRing(Device* device, vk::DeviceSize capacity): device(device), capacity(capacity)
+{
+	if (!device)
+		NFT_ERROR(VulkanFatal, "Device pointer is null in StagingRing constructor.");
+
+	buffer	  = device->GetBufferManager()->CreateBuffer(capacity,
+														 vk::BufferUsageFlagBits::eTransferSrc,
+														 vk::MemoryPropertyFlagBits::eHostVisible |
+															 vk::MemoryPropertyFlagBits::eHostCoherent);
+	vk_buffer = device->GetBufferManager()->Get(buffer)->vk_buffer;
+	mapped	  = static_cast<char*>(device->GetBufferManager()->Get(buffer)->mapped);
+}
+
+StagingRing::~StagingRing()
+{
+	while (!in_flight.empty())
+		RetireBatch();
+	for (vk::Fence fence : free_fences)
+		device->GetDevice().destroyFence(fence);
+	device->GetBufferManager()->DestroyBuffer(buffer);
+}
+
+StagingRing::Range StagingRing::Allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	if (size == 0 || size > capacity)
+		return {};
+
+	// Batches whose submissions are done give their space back first
+	while (!in_flight.empty() && device->GetDevice().getFenceStatus(in_flight.front().fence) == vk::Result::eSuccess)
+		RetireBatch();
+
+	while (true)
+	{
+		// With nothing in use the ring starts over, so any request up to the capacity fits
+		if (in_flight.empty() && !open)
+			head = tail = 0;
+
+		vk::DeviceSize offset = (head + alignment - 1) / alignment * alignment;
+		bool		   empty  = in_flight.empty() && !open;
+		bool		   fits	  = false;
+		if (head > tail || empty)
+		{
+			// Free space runs to the end of the ring, then from its start up to the tail
+			if (offset + size <= capacity)
+				fits = true;
+			else if (size <= tail)
+			{
+				offset = 0;
+				fits   = true;
+			}
+		}
+		else if (head < tail)
+			fits = offset + size <= tail;
+
+		if (fits)
+		{
+			head = offset + size;
+			open = true;
+			return { offset, size, mapped + offset };
+		}
+
+		// Only the open batch is left in the way, and it hasn't been submitted yet
+		if (in_flight.empty())
+			return {};
+		RetireBatch();
+	}
+}
+
+vk::Fence StagingRing::EndBatch()
+{
+	vk::Fence fence;
+	if (free_fences.empty())
+		fence = device->CreateFence(false);
+	else
+	{
+		fence = free_fences.back();
+		free_fences.pop_back();
+		device->GetDevice().resetFences(fence);
+	}
+
+	in_flight.push_back({ fence, head });
+	open = false;
+	return fence;
+}
+
+void StagingRing::RetireBatch()
+{
+	Batch batch = in_flight.front();
+	in_flight.pop_front();
+
+	if (device->GetDevice().waitForFences(batch.fence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess)
+		NFT_ERROR(VulkanFatal, "Failed To Wait For Staging Fence.");
+	free_fences.push_back(batch.fence);
+	tail = batch.end;
+}
+
+}	 // namespace nft::vulkan
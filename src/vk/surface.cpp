@@ -9,20 +9,94 @@
 #include "core/app.h"
 #include "core/error.h"
 
+#include "vk/deletion_queue.h"
 #include "vk/handler.h"
 #include "vk/image.h"
 #include "vk/scene.h"
+#include "vk/upload_scheduler.h"
 
 #include "core/glfw_common.h"
 
+#include <../generated/cull_shader.comp.spv.h>
 #include <../generated/picking_shader.frag.spv.h>
 #include <../generated/picking_shader.vert.spv.h>
 #include <../generated/simple_shader.frag.spv.h>
 #include <../generated/simple_shader.vert.spv.h>
 
+#include <algorithm>
+
 namespace nft::vulkan
 {
 
+namespace
+{
+// Material as the shaders read it; an index past the scene's materials gives the default material
+PackedMaterial PackMaterial(const std::vector<Material>& materials, uint32_t material_index)
+{
+	PackedMaterial packed;
+	if (material_index < materials.size())
+	{
+		const Material& material   = materials[material_index];
+		packed.ambient			   = material.ambient;
+		packed.diffuse			   = material.diffuse;
+		packed.specular			   = material.specular;
+		packed.specular_highlights = material.specular_highlights;
+		// Texture indices past the array (33) tell the shader to use the plain color
+		packed.diffuse_texture_index  = material.diffuse_texture_index != UINT32_MAX ? material.diffuse_texture_index : 33;
+		packed.ambient_texture_index  = material.ambient_texture_index != UINT32_MAX ? material.ambient_texture_index : 33;
+		packed.specular_texture_index = material.specular_texture_index != UINT32_MAX ? material.specular_texture_index : 33;
+	}
+	else
+	{
+		// Default material
+		packed.ambient				  = glm::vec3(0.1f);
+		packed.diffuse				  = glm::vec3(0.8f);
+		packed.specular				  = glm::vec3(0.5f);
+		packed.specular_highlights	  = 32.0f;
+		packed.diffuse_texture_index  = 0;	   // Use first texture as default
+		packed.ambient_texture_index  = 31;
+		packed.specular_texture_index = 31;
+	}
+	packed.padding = 0;
+	return packed;
+}
+
+// Set 0 of the main pipeline, per frame: camera, object transforms, and object materials + materials
+std::vector<DescriptorSetLayout::Binding> GetFrameBindings()
+{
+	return { { 0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex },
+			 { 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex },
+			 { 2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex },
+			 { 3, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment } };
+}
+
+// Set 0 of the culling pass: object transforms, candidates, draw commands and draw counts
+std::vector<DescriptorSetLayout::Binding> GetCullBindings()
+{
+	std::vector<DescriptorSetLayout::Binding> bindings;
+	for (int binding = 0; binding < 4; ++binding)
+		bindings.push_back({ binding, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute });
+	return bindings;
+}
+
+// Replaces a persistently mapped host-visible buffer by a larger one when it holds fewer than size bytes. The old
+// buffer goes through the deletion queue, so frames still reading it keep it until they retire.
+void ReserveMappedBuffer(Device* device, BufferHandle& buffer, void*& mapped, size_t size, vk::BufferUsageFlags usage)
+{
+	BufferManager* buffers	= device->GetBufferManager();
+	size_t		   capacity = buffer ? buffers->Get(buffer)->vk_buffer_info.size : 0;
+	if (size <= capacity)
+		return;
+
+	if (buffer)
+		buffers->DestroyBuffer(buffer);
+	buffer = buffers->CreateBuffer(std::max(size, capacity * 2),
+								   usage,
+								   vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+	mapped = buffers->Get(buffer)->mapped;
+}
+}	 // namespace
+
 //=============================================================================
 // CONSTRUCTOR & DESTRUCTOR
 //=============================================================================
@@ -49,6 +123,10 @@ Surface::Surface(Instance* instance, Device* device, Window* window):
 	texture_descriptor_pool(device),
 	pipeline_layout(device),
 	render_pass(device),
+	cull_shader_stage(device),
+	cull_set_layout(this),
+	cull_descriptor_pool(device),
+	cull_pipeline_layout(device),
 	clear_color(vk::ClearColorValue(std::array<float, 4> { 0.2f, 0.2f, 0.2f, 1.0f })),
 	clear_depth(vk::ClearDepthStencilValue(1.0f, 0)),
 	is_cleaned_up(false)
@@ -101,10 +179,11 @@ void Surface::Init()
 	scene = std::make_unique<Scene>(this, vk_command_buffer);
 	InitSwapchain();
 	CreatePipeline();
+	CreateCullPipeline();
 	CreateFrameBuffers();
 	CreateFrameCommandBuffers();
 
-	object_picker = std::make_unique<ObjectPicker>(device, extent);
+	object_picker = std::make_unique<ObjectPicker>(device, extent, scene->GetGeometryBatcher()->GetVertexFormat());
 }
 
 void Surface::InitSwapchain()
@@ -183,7 +262,7 @@ void Surface::CreateSwapchain()
 		.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
 		.setPresentMode(present_mode)
 		.setClipped(vk::True)
-		.setOldSwapchain(vk::SwapchainKHR(nullptr));
+		.setOldSwapchain(old_swapchain);
 
 	// Create the swapchain
 	try
@@ -194,6 +273,7 @@ void Surface::CreateSwapchain()
 	{
 		NFT_ERROR(VulkanFatal, std::format("Failed To Create Swapchain:\n{}", err.what()));
 	}
+	old_swapchain = VK_NULL_HANDLE;
 	// Get swapchain images and create image views
 	// Get swapchain images and create image views
 	std::vector<vk::Image> image_vec = device->vk_device.getSwapchainImagesKHR(vk_swapchain);
@@ -207,6 +287,8 @@ void Surface::CreateSwapchain()
 		frame.in_flight_fence			= device->CreateFence(true);
 		frame.image_available_semaphore = device->CreateSemaphore();
 		frame.render_finished_semaphore = device->CreateSemaphore();
+		if (device->SupportsPresentFences())
+			frame.present_fence = device->CreateFence(true);
 		frame.Init(this, scene.get());
 		frame.MakeDescriptorResources();
 
@@ -253,7 +335,6 @@ void Surface::CreateSwapchain()
 
 void Surface::RecreateSwapchain()
 {
-	// Wait for device to be idle before recreating swapchain
 	int width  = 0;
 	int height = 0;
 
@@ -263,8 +344,9 @@ void Surface::RecreateSwapchain()
 		glfwWaitEvents();
 	}
 
-	device->vk_device.waitIdle();
-	// Cleanup old swapchain resources
+	// Frames in flight keep using the old swapchain's resources; they are released through the deletion queue once
+	// those frames retire, so there is no need to wait for the device here. What pending presents still use, the
+	// render finished semaphores and the swapchain itself, is held until those presents are done.
 	CleanupSwapchain();
 	frame_descriptor_pool.Cleanup();
 	// Recreate swapchain and related resources
@@ -272,15 +354,18 @@ void Surface::RecreateSwapchain()
 	CreateFrameBuffers();
 	CreateFrameCommandBuffers();
 
-	std::vector<DescriptorSetLayout::Binding> frame_bindings = {
-		{ 0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex },
-		{ 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex }
-	};
-	frame_descriptor_pool.Init(frame_bindings, frames.size());
+	frame_descriptor_pool.Init(GetFrameBindings(), frames.size());
 
 	for (auto& frame : frames)
 		frame.AllocateDescriptorResources();
 
+	// Cull descriptor sets are allocated by the frames as they first need them
+	if (vk_cull_pipeline)
+	{
+		cull_descriptor_pool.Cleanup();
+		cull_descriptor_pool.Init(GetCullBindings(), frames.size());
+	}
+
 	if (object_picker)
 		object_picker->Recreate(extent);
 }
@@ -295,7 +380,7 @@ void Surface::CreatePipeline()
 	app->GetLogger()->Debug("Creating Pipeline...", "VKInit");
 
 	// Initialize pipeline stages for better performance with inline initialization
-	vertex_input_stage.Init();
+	vertex_input_stage.Init(scene->GetGeometryBatcher()->GetVertexFormat());
 	input_assembly_stage.Init(vk::PrimitiveTopology::eTriangleList);
 
 	// Initialize shader stages
@@ -310,7 +395,8 @@ void Surface::CreatePipeline()
 													.setFlags(vk::PipelineShaderStageCreateFlags())
 													.setStage(vk::ShaderStageFlagBits::eVertex)
 													.setModule(shader_stages.back().shader->GetShaderModule())
-													.setPName("main");
+													.setPName("main")
+													.setPSpecializationInfo(&vertex_input_stage.vk_specialization_info);
 
 	viewport_stage.Init(extent);
 	rasterization_stage.Init();
@@ -330,11 +416,8 @@ void Surface::CreatePipeline()
 	multisample_stage.Init();
 	color_blend_stage.Init();
 
-	// Set 0: Frame data (camera + object transforms)
-	std::vector<DescriptorSetLayout::Binding> frame_bindings = {
-		{ 0, vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex },
-		{ 1, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eVertex }
-	};
+	// Set 0: Frame data (camera + object transforms, object materials + materials)
+	std::vector<DescriptorSetLayout::Binding> frame_bindings = GetFrameBindings();
 
 	frame_set_layout.Init(frame_bindings);
 
@@ -357,12 +440,8 @@ void Surface::CreatePipeline()
 	// Create a single texture descriptor set for all material textures
 	CreateTextureDescriptorSet();
 
-	vk::PushConstantRange material_push_constant_range = vk::PushConstantRange()
-															 .setOffset(0)
-															 .setSize(sizeof(MaterialPushConstants))
-															 .setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-	pipeline_layout.Init(vk_descriptor_set_layouts, material_push_constant_range);
+	// Materials come from the frame's storage buffers, so the pipeline takes no push constants
+	pipeline_layout.Init(vk_descriptor_set_layouts);
 	render_pass.Init(format.format, depth_format);
 
 	// Create pipeline info with all stages
@@ -396,9 +475,61 @@ void Surface::CreatePipeline()
 		NFT_ERROR(VulkanFatal, std::format("Failed To Create Graphics Pipeline:\n{}", err.what()));
 	}
 
+	// Indirect draw commands carry the first instance of their bucket, which needs drawIndirectFirstInstance
+	supports_indirect_draws = device->GetDeviceFeatures().drawIndirectFirstInstance;
+	if (!supports_indirect_draws)
+		app->GetLogger()->Warn("drawIndirectFirstInstance is not supported, buckets are drawn one by one", "VKInit");
+
 	app->GetLogger()->Debug("Pipeline Created Successfully!", "VKInit");
 }
 
+void Surface::CreateCullPipeline()
+{
+	// Culling writes commands for the indirect draws, so it needs those, and compute on the graphics queue
+	uint32_t				  graphics_family	= device->queue_family_indices.graphics_family.value();
+	vk::QueueFamilyProperties family_properties = device->vk_physical_device.getQueueFamilyProperties()[graphics_family];
+	bool					  graphics_compute	= static_cast<bool>(family_properties.queueFlags & vk::QueueFlagBits::eCompute);
+	if (!supports_indirect_draws || !graphics_compute)
+	{
+		app->GetLogger()->Warn("GPU culling is not available, indirect draws are not culled", "VKInit");
+		return;
+	}
+
+	app->GetLogger()->Debug("Creating Cull Pipeline...", "VKInit");
+
+	cull_shader_stage.shader =
+		std::make_unique<Shader>(device, Shader::ShaderCode { (uint32_t*)cull_shader_comp, cull_shader_comp_len });
+	cull_shader_stage.vk_shader_stage_info = vk::PipelineShaderStageCreateInfo()
+												 .setFlags(vk::PipelineShaderStageCreateFlags())
+												 .setStage(vk::ShaderStageFlagBits::eCompute)
+												 .setModule(cull_shader_stage.shader->GetShaderModule())
+												 .setPName("main");
+
+	std::vector<DescriptorSetLayout::Binding> cull_bindings = GetCullBindings();
+	cull_set_layout.Init(cull_bindings);
+	cull_descriptor_pool.Init(cull_bindings, frames.size());
+
+	vk::PushConstantRange cull_push_constant_range = vk::PushConstantRange()
+														 .setOffset(0)
+														 .setSize(sizeof(CullPushConstants))
+														 .setStageFlags(vk::ShaderStageFlagBits::eCompute);
+	cull_pipeline_layout.Init({ cull_set_layout.vk_descriptor_set_layout }, { cull_push_constant_range });
+
+	vk::ComputePipelineCreateInfo cull_pipeline_info = vk::ComputePipelineCreateInfo()
+														   .setStage(cull_shader_stage.vk_shader_stage_info)
+														   .setLayout(cull_pipeline_layout.vk_pipeline_layout);
+	try
+	{
+		vk_cull_pipeline = device->vk_device.createComputePipeline(nullptr, cull_pipeline_info).value;
+	}
+	catch (const vk::SystemError& err)
+	{
+		NFT_ERROR(VulkanFatal, std::format("Failed To Create Cull Pipeline:\n{}", err.what()));
+	}
+
+	app->GetLogger()->Debug("Cull Pipeline Created Successfully!", "VKInit");
+}
+
 void Surface::CreateTextureDescriptorSet()
 {
 	// Create texture array descriptor set
@@ -421,6 +552,11 @@ void Surface::CreateTextureDescriptorSet()
 		NFT_ERROR(VulkanFatal, std::format("Failed To Allocate Texture Array Descriptor Set:\n{}", err.what()));
 	}
 
+	UpdateTextureDescriptorSet();
+}
+
+void Surface::UpdateTextureDescriptorSet()
+{
 	// Create array of descriptor image infos
 	std::vector<vk::DescriptorImageInfo> image_infos;
 	image_infos.reserve(32);	// Reserve space for 32 textures
@@ -453,6 +589,7 @@ void Surface::CreateTextureDescriptorSet()
 												  .setPImageInfo(image_infos.data());
 
 	device->vk_device.updateDescriptorSets(1, &descriptor_write, 0, nullptr);
+	textures_version = scene->GetTexturesVersion();
 }
 
 //=============================================================================
@@ -543,20 +680,29 @@ void Surface::PrepareScene(vk::CommandBuffer command_buffer)
 		return;
 	}
 
-	vk::Buffer	 vertex_buffers[] = { scene->GetGeometryBatcher()->vertex_buffer->vk_buffer };
+	vk::Buffer	 vertex_buffers[] = { device->GetBufferManager()->Get(scene->GetGeometryBatcher()->vertex_buffer)->vk_buffer };
 	VkDeviceSize offsets[]		  = { 0 };	  // Start from the beginning of the buffer
 	command_buffer.bindVertexBuffers(0, 1, vertex_buffers, offsets);
-	if (scene->geometry_batcher->index_data.empty())
-		return;
-	command_buffer.bindIndexBuffer(scene->geometry_batcher->index_buffer->vk_buffer, 0, vk::IndexType::eUint32);
+	// The index buffer is bound per mesh in RecordDrawCommands, since its index type varies between meshes
 }
 
 void Surface::Render()
 {
+	// Streamed assets land a few per frame. Meshes move to new ranges and buffers without waiting for frames in
+	// flight; only a texture landing drains the device, as its old image goes right away. The texture descriptors
+	// are rewritten while it is still drained.
+	UploadScheduler* uploads = device->GetUploadScheduler();
+	if (scene->HasLoadedAssets())
+		scene->ProcessLoadedAssets();
+	if (textures_version != scene->GetTexturesVersion())
+		UpdateTextureDescriptorSet();
+
 	Frame& current_frame = frames[frame_index];
 
 	device->vk_device.waitForFences(current_frame.in_flight_fence, VK_TRUE, UINT64_MAX);
 	device->vk_device.resetFences(current_frame.in_flight_fence);
+	// Resources destroyed before this frame's last submission can go now
+	device->GetDeletionQueue()->RetireFrame(current_frame.submitted_frame);
 
 	uint32_t image_index;
 	try
@@ -575,39 +721,67 @@ void Surface::Render()
 		return;
 	}
 
+	// The image is back, so its last present is done, and with it every present queued before
+	completed_presents = std::max(completed_presents, frames[image_index].presented);
+	RetirePresents();
+
 	vk::CommandBuffer command_buffer = current_frame.vk_command_buffer;
 	command_buffer.reset(vk::CommandBufferResetFlags());
 
 	current_frame.Prepare(scene->camera_transforms);
 	RecordDrawCommands(current_frame, image_index);
 
-	vk::PipelineStageFlags wait_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	// Besides the swapchain image, the frame waits on the GPU for every upload submitted so far
+	std::array<vk::Semaphore, 2>		  wait_semaphores = { current_frame.image_available_semaphore, uploads->GetSemaphore() };
+	std::array<vk::PipelineStageFlags, 2> wait_stages	  = { vk::PipelineStageFlagBits::eColorAttachmentOutput,
+															  uploads->GetWaitStages() };
+	std::array<uint64_t, 2>				  wait_values	  = { 0, uploads->GetSubmittedValue() };	// The first is binary
+	uint32_t							  wait_count	  = uploads->UsesTimeline() && wait_values[1] > 0 ? 2 : 1;
+	vk::TimelineSemaphoreSubmitInfo		  timeline_info	  = vk::TimelineSemaphoreSubmitInfo()
+															.setWaitSemaphoreValueCount(wait_count)
+															.setPWaitSemaphoreValues(wait_values.data());
 
 	vk::SubmitInfo submit_info = vk::SubmitInfo()
-									 .setWaitSemaphoreCount(1)
-									 .setPWaitSemaphores(&current_frame.image_available_semaphore)
-									 .setPWaitDstStageMask(&wait_stages)
+									 .setWaitSemaphoreCount(wait_count)
+									 .setPWaitSemaphores(wait_semaphores.data())
+									 .setPWaitDstStageMask(wait_stages.data())
 									 .setCommandBufferCount(1)
 									 .setPCommandBuffers(&command_buffer)
 									 .setSignalSemaphoreCount(1)
 									 .setPSignalSemaphores(&frames[image_index].render_finished_semaphore);
+	if (wait_count > 1)
+		submit_info.setPNext(&timeline_info);
 
 	try
 	{
 		device->vk_graphics_queue.submit(submit_info, current_frame.in_flight_fence);
+		current_frame.submitted_frame = device->GetDeletionQueue()->SubmitFrame();
 	}
 	catch (const vk::SystemError& err)
 	{
 		NFT_ERROR(VulkanFatal, std::format("Failed To Submit Draw Command Buffer:\n{}", err.what()));
 	}
 
+	Frame&			   image_frame	= frames[image_index];
 	vk::PresentInfoKHR present_info = vk::PresentInfoKHR()
 										  .setWaitSemaphoreCount(1)
-										  .setPWaitSemaphores(&frames[image_index].render_finished_semaphore)
+										  .setPWaitSemaphores(&image_frame.render_finished_semaphore)
 										  .setSwapchainCount(1)
 										  .setPSwapchains(&vk_swapchain)
 										  .setPImageIndices(&image_index);
 
+	// With present fences the present signals the image's fence, which its previous present has signaled by now
+	vk::SwapchainPresentFenceInfoEXT present_fence_info =
+		vk::SwapchainPresentFenceInfoEXT().setSwapchainCount(1).setPFences(&image_frame.present_fence);
+	if (image_frame.present_fence)
+	{
+		device->vk_device.waitForFences(image_frame.present_fence, VK_TRUE, UINT64_MAX);
+		device->vk_device.resetFences(image_frame.present_fence);
+		present_info.setPNext(&present_fence_info);
+	}
+	// Queued even if the swapchain turns out to be out of date
+	image_frame.presented = ++present_count;
+
 	vk::Result present_result;
 	try
 	{
@@ -628,6 +802,46 @@ void Surface::RecordDrawCommands(Frame& frame, uint32_t image_index)
 	vk::CommandBufferBeginInfo begin_info	  = vk::CommandBufferBeginInfo();
 	command_buffer.begin(begin_info);
 
+	// Images uploaded on a dedicated transfer queue change ownership before this frame samples them
+	device->GetUploadScheduler()->RecordAcquires(command_buffer);
+
+	// Geometry compaction is spread over frames, so removing meshes doesn't leave the arena full of holes. Its copies
+	// go ahead of everything else, as the mesh offsets read below already point at the moved ranges.
+	GeometryBatcher*					geometry_batcher = scene->geometry_batcher.get();
+	GeometryBatcher::FragmentationStats fragmentation	 = geometry_batcher->GetFragmentationStats();
+	if (compacting || fragmentation.vertices.GetFragmentation() > compaction_threshold
+		|| fragmentation.indices.GetFragmentation() > compaction_threshold)
+		compacting = geometry_batcher->Compact(compaction_budget, command_buffer);
+
+	// Meshlets are culled against this frame's camera; only the surviving index ranges are drawn
+	meshlet_culler.ResetStats();
+	meshlet_culler.SetView(frame.camera_data.proj * frame.camera_data.view, frame.camera_data.pos);
+
+	// Levels of detail are picked so their error stays below lod_pixel_error on screen
+	float lod_pixel_scale = std::abs(frame.camera_data.proj[1][1]) * static_cast<float>(extent.height) * 0.5f;
+
+	const auto&	  meshes			 = scene->geometry_batcher->mesh_data;
+	const Buffer* index_buffer		 = device->GetBufferManager()->Get(scene->geometry_batcher->index_buffer);
+
+	// On the direct path whole objects are culled by their meshes' bounding spheres before they get an instance
+	bool indirect = UsesIndirectDraws();
+	if (!indirect)
+	{
+		frustum_culler.SetView(frame.camera_data.proj * frame.camera_data.view);
+		frustum_culler.Clear();
+		for (const ObjectData& object : scene->objects)
+		{
+			auto mesh_entry = meshes.find(object.mesh);
+			frustum_culler.Add(mesh_entry != meshes.end() ? mesh_entry->second.sphere : glm::vec4(0.0f), object.transform);
+		}
+		frustum_culler.Cull(visible_objects);
+	}
+	WriteInstances(frame, lod_pixel_scale, indirect ? nullptr : &visible_objects);
+
+	// Indirect draws are written, and culled on the GPU, before the render pass begins
+	if (indirect)
+		WriteIndirectDraws(frame, command_buffer);
+
 	std::vector<vk::ClearValue> clear_values = { clear_color, clear_depth };
 
 	vk::RenderPassBeginInfo render_pass_begin_info = vk::RenderPassBeginInfo()
@@ -646,119 +860,377 @@ void Surface::RecordDrawCommands(Frame& frame, uint32_t image_index)
 	command_buffer.bindDescriptorSets(
 		vk::PipelineBindPoint::eGraphics, pipeline_layout.vk_pipeline_layout, 1, { texture_descriptor_set }, nullptr);
 
-	command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vk_pipeline);
-
 	PrepareScene(command_buffer);
 
-	//app->GetLogger()->Debug(std::format("Total objects: {}", scene->objects.size()), "VKRender");
-	//app->GetLogger()->Debug(std::format("Mesh data entries: {}", scene->geometry_batcher->mesh_data.size()), "VKRender");
-
-	const auto& meshes = scene->geometry_batcher->mesh_data;
+	if (indirect)
+	{
+		command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vk_pipeline);
+		RecordIndirectDraws(frame, command_buffer);
+		command_buffer.endRenderPass();
+		command_buffer.end();
+		return;
+	}
 
-	for (const auto& mesh_entry : meshes)
+	// One instanced draw per bucket, in sort key order; state the previous bucket bound already is skipped
+	for (const InstanceBucket& bucket : instance_buckets)
 	{
-		const IMesh*					 mesh	   = mesh_entry.first;
-		const GeometryBatcher::MeshData& mesh_data = mesh_entry.second;
+		const GeometryBatcher::MeshData& mesh_data = meshes.at(bucket.mesh);
+
+		if (render_queue.NeedsBind(RenderQueue::State::Pipeline, 0))
+			command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, vk_pipeline);
 
 		uint32_t vertex_count = static_cast<uint32_t>(mesh_data.size);
 		uint32_t first_vertex = static_cast<uint32_t>(mesh_data.offset);
 		uint32_t index_count  = static_cast<uint32_t>(mesh_data.index_size);
 		uint32_t first_index  = static_cast<uint32_t>(mesh_data.index_offset);
 
-		//app->GetLogger()->Debug(
-		//	std::format(
-		//		"Mesh vertex data: count={}, offset={}, data_size={}", vertex_count, first_vertex, mesh->vertices->size()),
-		//	"VKRender");
+		// All meshes share the index buffer; it is rebound only when the index type changes
+		if (index_count != 0 && index_buffer
+			&& render_queue.NeedsBind(RenderQueue::State::IndexBuffer, static_cast<uint32_t>(mesh_data.index_type)))
+			command_buffer.bindIndexBuffer(index_buffer->vk_buffer, 0, mesh_data.index_type);
 
-		// Draw each object separately with per-object material push constants
-		for (uint32_t instance_id = 0; instance_id < scene->objects.size(); ++instance_id)
+		if (index_count == 0)
 		{
-			if (scene->objects[instance_id].mesh == mesh)
-			{
-				const auto& object = scene->objects[instance_id];
-
-				//app->GetLogger()->Debug(std::format("Drawing object {}: vertex_count={}, first_vertex={}, instance_id={}",
-				//									instance_id,
-				//									vertex_count,
-				//									first_vertex,
-				//									instance_id),
-				//						"VKRender");
-
-				// Create material push constants for this object
-				MaterialPushConstants material_push;
-				if (object.material_index < scene->materials.size())
-				{
-					const auto& material			  = scene->materials[object.material_index];
-					material_push.ambient			  = material.ambient;
-					material_push.diffuse			  = material.diffuse;
-					material_push.specular			  = material.specular;
-					material_push.specular_highlights = material.specular_highlights;
-					material_push.diffuse_texture_index =
-						material.diffuse_texture_index != UINT32_MAX ? material.diffuse_texture_index : 33;
-					material_push.ambient_texture_index	 = material.ambient_texture_index != UINT32_MAX
-															   ? material.ambient_texture_index
-															   : 33;	// Use invalid index (will be clamped in shader)
-					material_push.specular_texture_index = material.specular_texture_index != UINT32_MAX
-															   ? material.specular_texture_index
-															   : 33;	// Use invalid index
-					material_push.padding				 = 0;
-				}
-				else
-				{
-					// Default material
-					material_push.ambient				 = glm::vec3(0.1f);
-					material_push.diffuse				 = glm::vec3(0.8f);
-					material_push.specular				 = glm::vec3(0.5f);
-					material_push.specular_highlights	 = 32.0f;
-					material_push.diffuse_texture_index	 = 0;	  // Use first texture as default
-					material_push.ambient_texture_index	 = 31;	  // Invalid index
-					material_push.specular_texture_index = 31;	  // Invalid index
-					material_push.padding				 = 0;
-				}
-
-				// Push the material constants
-				command_buffer.pushConstants(pipeline_layout.vk_pipeline_layout,
-											 vk::ShaderStageFlagBits::eFragment,
-											 0,
-											 sizeof(MaterialPushConstants),
-											 &material_push);
-
-				if (index_count == 0)
-				{
-					// Draw without index buffer
-					command_buffer.draw(vertex_count, 1, first_vertex, instance_id);
-				}
-				else
-				{
-					// Draw with index buffer
-					command_buffer.drawIndexed(index_count, 1, first_index, 0, instance_id);
-				}
-			}
+			// Draw without index buffer
+			command_buffer.draw(vertex_count, bucket.instance_count, first_vertex, bucket.first_instance);
+			continue;
 		}
+
+		// Draw with index buffer; indices are local to the mesh, so offset them to its first vertex
+		const GeometryBatcher::LodRange& lod = mesh_data.lods[bucket.level];
+
+		// Meshlets only cover LOD 0 and are culled against a single transform, so only lone instances use them;
+		// coarser levels and shared buckets are drawn whole
+		std::span<const Meshlet> meshlets = bucket.mesh->GetMeshlets();
+		if (bucket.level > 0 || bucket.instance_count > 1 || meshlets.empty())
+		{
+			command_buffer.drawIndexed(
+				lod.index_count, bucket.instance_count, lod.first_index, static_cast<int32_t>(first_vertex), bucket.first_instance);
+			continue;
+		}
+
+		const ObjectData& object = scene->objects[instance_objects[bucket.first_instance]];
+		meshlet_culler.Cull(meshlets, object.transform, visible_ranges);
+		for (const MeshletCuller::IndexRange& range : visible_ranges)
+			command_buffer.drawIndexed(
+				range.index_count, 1, first_index + range.first_index, static_cast<int32_t>(first_vertex), bucket.first_instance);
 	}
 
 	command_buffer.endRenderPass();
 	command_buffer.end();
 }
 
+void Surface::WriteInstances(Frame& frame, float lod_pixel_scale, const std::vector<uint8_t>* visible)
+{
+	const GeometryBatcher*		   geometry_batcher = scene->geometry_batcher.get();
+	const std::vector<ObjectData>& objects			= scene->objects;
+
+	// Every object with geometry that survived culling is queued; index type, mesh and level decide the bucket,
+	// view depth the order within it
+	const glm::mat4& view = frame.camera_data.view;
+	render_queue.Clear();
+	object_levels.resize(objects.size());
+	for (uint32_t object_index = 0; object_index < objects.size(); ++object_index)
+	{
+		const ObjectData& object	 = objects[object_index];
+		auto			  mesh_entry = geometry_batcher->mesh_data.find(object.mesh);
+		if (mesh_entry == geometry_batcher->mesh_data.end() || (visible && !(*visible)[object_index]))
+			continue;
+
+		const GeometryBatcher::MeshData& mesh_data = mesh_entry->second;
+		object_levels[object_index]				   = 0;
+		if (mesh_data.index_size != 0)
+			object_levels[object_index] = static_cast<uint32_t>(GeometryBatcher::SelectLod(
+				mesh_data, object.transform, frame.camera_data.pos, lod_pixel_scale, lod_pixel_error));
+
+		float depth = -(view * object.transform[3]).z;
+		render_queue.Push(RenderQueue::MakeKey(0,
+											   mesh_data.index_type == vk::IndexType::eUint32 ? 1 : 0,
+											   mesh_data.id,
+											   object_levels[object_index],
+											   depth,
+											   object.material_index),
+						  object_index);
+	}
+	render_queue.Sort();
+
+	// Each bucket's transforms and material indices end up contiguous, at the instance indices its draw covers.
+	// Mesh ids and materials are truncated in the key, so they are compared as well: the fragment shader indexes
+	// the texture array by material, which must not vary within a draw.
+	auto* transforms	   = static_cast<glm::mat4*>(frame.object_transform_ptr);
+	auto* object_materials = static_cast<uint32_t*>(frame.object_material_ptr);
+	instance_objects.clear();
+	instance_buckets.clear();
+	uint64_t batch	  = 0;
+	uint32_t material = 0;
+	for (const RenderQueue::Entry& entry : render_queue.GetEntries())
+	{
+		uint32_t		  instance = static_cast<uint32_t>(instance_objects.size());
+		const ObjectData& object   = objects[entry.value];
+		uint32_t		  level	   = object_levels[entry.value];
+		if (instance_buckets.empty() || (entry.key >> RenderQueue::batch_shift) != batch
+			|| instance_buckets.back().mesh != object.mesh || object.material_index != material)
+			instance_buckets.push_back({ object.mesh, level, instance, 0 });
+		instance_buckets.back().instance_count++;
+		instance_objects.push_back(entry.value);
+		batch	 = entry.key >> RenderQueue::batch_shift;
+		material = object.material_index;
+
+		transforms[instance]	   = object.transform * geometry_batcher->GetMeshTransform(object.mesh);
+		object_materials[instance] = std::min<uint32_t>(object.material_index, scene->materials.size());
+	}
+}
+
+void Surface::WriteIndirectDraws(Frame& frame, vk::CommandBuffer command_buffer)
+{
+	const GeometryBatcher* geometry_batcher = scene->geometry_batcher.get();
+	const size_t		   object_count		= scene->objects.size();
+	const bool			   gpu_cull			= UsesGpuCulling();
+
+	ReserveMappedBuffer(device,
+						frame.indirect_command_buffer,
+						frame.indirect_command_ptr,
+						std::max<size_t>(object_count, 1) * sizeof(vk::DrawIndexedIndirectCommand),
+						vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer);
+	frame.indirect_command_capacity =
+		device->GetBufferManager()->Get(frame.indirect_command_buffer)->vk_buffer_info.size / sizeof(vk::DrawIndexedIndirectCommand);
+	if (gpu_cull)
+		ReserveMappedBuffer(device,
+							frame.cull_object_buffer,
+							frame.cull_object_ptr,
+							frame.indirect_command_capacity * sizeof(CullObject),
+							vk::BufferUsageFlagBits::eStorageBuffer);
+
+	// One pass over the buckets, no per-mesh scan: 16-bit index draws fill the buffer from the front and 32-bit
+	// ones from the back, so each index type ends up as one contiguous run of commands. With GPU culling the
+	// candidates are laid out the same way and the culling pass writes the commands.
+	auto*  commands	   = static_cast<vk::DrawIndexedIndirectCommand*>(frame.indirect_command_ptr);
+	auto*  candidates  = static_cast<CullObject*>(frame.cull_object_ptr);
+	size_t short_count = 0;
+	size_t long_count  = 0;
+	unindexed_draws.clear();
+	for (const InstanceBucket& bucket : instance_buckets)
+	{
+		const GeometryBatcher::MeshData& mesh_data = geometry_batcher->mesh_data.at(bucket.mesh);
+
+		// Meshes without indices are rare enough to draw directly
+		if (mesh_data.index_size == 0)
+		{
+			unindexed_draws.push_back(vk::DrawIndirectCommand()
+										  .setVertexCount(static_cast<uint32_t>(mesh_data.size))
+										  .setInstanceCount(bucket.instance_count)
+										  .setFirstVertex(static_cast<uint32_t>(mesh_data.offset))
+										  .setFirstInstance(bucket.first_instance));
+			continue;
+		}
+
+		// Whole levels of detail; meshlet culling stays on the per-object path
+		const GeometryBatcher::LodRange& lod = mesh_data.lods[bucket.level];
+		auto next_slot = [&]()
+		{
+			return mesh_data.index_type == vk::IndexType::eUint16 ? short_count++ : frame.indirect_command_capacity - ++long_count;
+		};
+
+		if (!gpu_cull)
+		{
+			commands[next_slot()] = vk::DrawIndexedIndirectCommand()
+										.setIndexCount(lod.index_count)
+										.setInstanceCount(bucket.instance_count)
+										.setFirstIndex(lod.first_index)
+										.setVertexOffset(static_cast<int32_t>(mesh_data.offset))
+										.setFirstInstance(bucket.first_instance);
+			continue;
+		}
+
+		// The culling pass decides per instance, so each one keeps a command of its own
+		Bounds bounds = geometry_batcher->GetVertexBounds(mesh_data);
+		for (uint32_t instance = bucket.first_instance; instance < bucket.first_instance + bucket.instance_count; ++instance)
+			candidates[next_slot()] = { bounds.min,
+										lod.index_count,
+										bounds.max,
+										lod.first_index,
+										static_cast<int32_t>(mesh_data.offset),
+										instance,
+										{ 0, 0 } };
+	}
+	frame.indirect_short_count = short_count;
+	frame.indirect_long_count  = long_count;
+	frame.indirect_counted	   = false;
+	if (!gpu_cull || short_count + long_count == 0)
+		return;
+
+	// Culled draws are compacted away when the render pass can read the draw counts from the GPU. Otherwise
+	// every command stays in its slot, with an instance count of 0 if culled.
+	frame.indirect_counted = device->SupportsDrawIndirectCount() && device->GetDeviceFeatures().multiDrawIndirect
+							 && std::max(short_count, long_count) <= device->GetDeviceProperties().limits.maxDrawIndirectCount;
+
+	ReserveMappedBuffer(device,
+						frame.draw_count_buffer,
+						frame.draw_count_ptr,
+						2 * sizeof(uint32_t),
+						vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+							vk::BufferUsageFlagBits::eTransferDst);
+
+	if (!frame.cull_descriptor_set)
+	{
+		vk::DescriptorSetAllocateInfo alloc_info = vk::DescriptorSetAllocateInfo()
+													   .setDescriptorPool(cull_descriptor_pool.vk_descriptor_pool)
+													   .setDescriptorSetCount(1)
+													   .setPSetLayouts(&cull_set_layout.vk_descriptor_set_layout);
+		try
+		{
+			frame.cull_descriptor_set = device->vk_device.allocateDescriptorSets(alloc_info)[0];
+		}
+		catch (const vk::SystemError& err)
+		{
+			NFT_ERROR(VulkanFatal, std::format("Failed To Allocate Cull Descriptor Set:\n{}", err.what()));
+		}
+	}
+
+	// The buffers may have been replaced since the last frame, so the set is rewritten every time
+	BufferManager*							buffers		 = device->GetBufferManager();
+	vk::Buffer								draw_counts	 = buffers->Get(frame.draw_count_buffer)->vk_buffer;
+	std::array<vk::DescriptorBufferInfo, 4> buffer_infos = {
+		vk::DescriptorBufferInfo().setBuffer(buffers->Get(frame.object_transform_buffer)->vk_buffer).setOffset(0).setRange(VK_WHOLE_SIZE),
+		vk::DescriptorBufferInfo().setBuffer(buffers->Get(frame.cull_object_buffer)->vk_buffer).setOffset(0).setRange(VK_WHOLE_SIZE),
+		vk::DescriptorBufferInfo().setBuffer(buffers->Get(frame.indirect_command_buffer)->vk_buffer).setOffset(0).setRange(VK_WHOLE_SIZE),
+		vk::DescriptorBufferInfo().setBuffer(draw_counts).setOffset(0).setRange(VK_WHOLE_SIZE)
+	};
+	std::array<vk::WriteDescriptorSet, 4> descriptor_writes;
+	for (uint32_t binding = 0; binding < descriptor_writes.size(); ++binding)
+		descriptor_writes[binding] = vk::WriteDescriptorSet()
+										 .setDstSet(frame.cull_descriptor_set)
+										 .setDstBinding(binding)
+										 .setDstArrayElement(0)
+										 .setDescriptorCount(1)
+										 .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+										 .setPBufferInfo(&buffer_infos[binding]);
+	device->vk_device.updateDescriptorSets(descriptor_writes.size(), descriptor_writes.data(), 0, nullptr);
+
+	CullPushConstants cull_constants;
+	std::copy_n(meshlet_culler.GetFrustumPlanes(), 6, cull_constants.planes);
+	cull_constants.short_count = static_cast<uint32_t>(short_count);
+	cull_constants.long_start  = static_cast<uint32_t>(frame.indirect_command_capacity - long_count);
+	cull_constants.long_count  = static_cast<uint32_t>(long_count);
+	cull_constants.compact	   = frame.indirect_counted ? 1 : 0;
+
+	// Reset the counts, cull, then hand the commands to the indirect draws
+	command_buffer.fillBuffer(draw_counts, 0, 2 * sizeof(uint32_t), 0);
+	command_buffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer,
+		vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(),
+		vk::MemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+		nullptr,
+		nullptr);
+
+	command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, vk_cull_pipeline);
+	command_buffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute, cull_pipeline_layout.vk_pipeline_layout, 0, { frame.cull_descriptor_set }, nullptr);
+	command_buffer.pushConstants(cull_pipeline_layout.vk_pipeline_layout,
+								 vk::ShaderStageFlagBits::eCompute,
+								 0,
+								 sizeof(CullPushConstants),
+								 &cull_constants);
+	command_buffer.dispatch(static_cast<uint32_t>((short_count + long_count + 63) / 64), 1, 1);
+
+	command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+								   vk::PipelineStageFlagBits::eDrawIndirect,
+								   vk::DependencyFlags(),
+								   vk::MemoryBarrier()
+									   .setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+									   .setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead),
+								   nullptr,
+								   nullptr);
+}
+
+void Surface::RecordIndirectDraws(Frame& frame, vk::CommandBuffer command_buffer)
+{
+	const GeometryBatcher* geometry_batcher = scene->geometry_batcher.get();
+
+	for (const vk::DrawIndirectCommand& draw : unindexed_draws)
+		command_buffer.draw(draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+
+	// Without multiDrawIndirect each indirect draw takes a single command
+	const vk::DeviceSize stride			= sizeof(vk::DrawIndexedIndirectCommand);
+	const size_t		 max_draw_count = device->GetDeviceFeatures().multiDrawIndirect
+											  ? device->GetDeviceProperties().limits.maxDrawIndirectCount
+											  : 1;
+	BufferManager*	 buffers		   = device->GetBufferManager();
+	const Buffer*	 index_buffer	   = buffers->Get(geometry_batcher->index_buffer);
+	const vk::Buffer indirect_commands = buffers->Get(frame.indirect_command_buffer)->vk_buffer;
+
+	auto draw_run = [&](vk::IndexType index_type, size_t first, size_t count, uint32_t run)
+	{
+		if (count == 0)
+			return;
+		command_buffer.bindIndexBuffer(index_buffer->vk_buffer, 0, index_type);
+		if (frame.indirect_counted)
+		{
+			command_buffer.drawIndexedIndirectCount(indirect_commands,
+													first * stride,
+													buffers->Get(frame.draw_count_buffer)->vk_buffer,
+													run * sizeof(uint32_t),
+													static_cast<uint32_t>(count),
+													static_cast<uint32_t>(stride));
+			return;
+		}
+		for (size_t drawn = 0; drawn < count;)
+		{
+			uint32_t draw_count = static_cast<uint32_t>(std::min(count - drawn, max_draw_count));
+			command_buffer.drawIndexedIndirect(indirect_commands, (first + drawn) * stride, draw_count, static_cast<uint32_t>(stride));
+			drawn += draw_count;
+		}
+	};
+	draw_run(vk::IndexType::eUint16, 0, frame.indirect_short_count, 0);
+	draw_run(vk::IndexType::eUint32,
+			 frame.indirect_command_capacity - frame.indirect_long_count,
+			 frame.indirect_long_count,
+			 1);
+}
+
 //=============================================================================
 // CLEANUP METHODS
 //=============================================================================
 
 void Surface::CleanupSwapchain()
 {
-	// Cleanup swapchain resources
+	// Cleanup frame resources, including the views of the swapchain images, ahead of the swapchain
+	for (auto& frame : frames)
+		frame.Cleanup();
+	frames.clear();
+
+	// The swapchain stays valid until its presents are done, and is handed to its successor meanwhile. It then goes
+	// through the deletion queue, behind the views of its images.
 	if (vk_swapchain && device && instance)
 	{
-		device->vk_device.destroySwapchainKHR(vk_swapchain);
+		old_swapchain = vk_swapchain;
+		auto destroy = [device = device, swapchain = vk_swapchain]()
+		{ device->GetDeletionQueue()->Push([device, swapchain]() { device->vk_device.destroySwapchainKHR(swapchain); }); };
+		present_retirements.push_back({ present_count, nullptr, destroy });
 		vk_swapchain = VK_NULL_HANDLE;
 		if (app && app->GetLogger())
-			app->GetLogger()->Debug("Swapchain destroyed successfully", "VKShutdown");
+			app->GetLogger()->Debug("Swapchain retired", "VKShutdown");
 	}
-	// Cleanup frame resources
-	for (auto& frame : frames)
-		frame.Cleanup();
-	frames.clear();
+}
+
+void Surface::RetirePresents()
+{
+	// A signaled present fence also shows every present queued before its own is done
+	for (const PresentRetirement& retirement : present_retirements)
+		if (retirement.fence && device->vk_device.getFenceStatus(retirement.fence) == vk::Result::eSuccess)
+			completed_presents = std::max(completed_presents, retirement.present);
+
+	std::erase_if(present_retirements,
+				  [this](const PresentRetirement& retirement)
+				  {
+					  if (retirement.present > completed_presents)
+						  return false;
+					  retirement.destroy();
+					  return true;
+				  });
 }
 
 void Surface::Cleanup()
@@ -774,18 +1246,23 @@ void Surface::Cleanup()
 
 		app->GetLogger()->Debug("Cleaning up Surface Vulkan objects...", "VKShutdown");
 
-		if (vk_command_pool)
-		{
-			device->vk_device.destroyCommandPool(vk_command_pool);
-			vk_command_pool = VK_NULL_HANDLE;
-		}
-
 		if (vk_pipeline)
 		{
 			device->vk_device.destroyPipeline(vk_pipeline);
 			vk_pipeline = VK_NULL_HANDLE;
 		}
 
+
+		if (vk_cull_pipeline)
+		{
+			device->vk_device.destroyPipeline(vk_cull_pipeline);
+			vk_cull_pipeline = VK_NULL_HANDLE;
+		}
+		cull_shader_stage.shader.reset();
+		cull_pipeline_layout.Cleanup();
+		cull_descriptor_pool.Cleanup();
+		cull_set_layout.Cleanup();
+
 		for (auto& shader_stage : shader_stages)
 			if (shader_stage.shader)
 				shader_stage.shader.reset();	// This calls Shader destructor which destroys the shader module
@@ -799,6 +1276,18 @@ void Surface::Cleanup()
 		frame_descriptor_pool.Cleanup();
 		texture_descriptor_pool.Cleanup();
 
+		// The device is idle, so every present is done and what the deletion queue holds can go now, before the
+		// pool the frames' command buffers came from
+		completed_presents = present_count;
+		RetirePresents();
+		device->GetDeletionQueue()->Flush();
+		old_swapchain = VK_NULL_HANDLE;
+		if (vk_command_pool)
+		{
+			device->vk_device.destroyCommandPool(vk_command_pool);
+			vk_command_pool = VK_NULL_HANDLE;
+		}
+
 		frame_set_layout.Cleanup();
 		texture_set_layout.Cleanup();
 
@@ -1028,8 +1517,7 @@ void Surface::Frame::MakeDescriptorResources()
 															  vk::BufferUsageFlagBits::eUniformBuffer,
 															  vk::MemoryPropertyFlagBits::eHostVisible |
 																  vk::MemoryPropertyFlagBits::eHostCoherent);
-	camera_data_ptr	   = device->vk_device.mapMemory(
-		   camera_data_buffer->vk_memory, 0, camera_data_buffer->vk_memory_info.allocationSize, vk::MemoryMapFlags());
+	camera_data_ptr	   = device->buffer_manager->Get(camera_data_buffer)->mapped;
 
 	size_t buffer_size	= sizeof(glm::mat4) * scene->objects.size();
 	size_t aligned_size = ((buffer_size + 15) / 16) * 16;	 // Align to 256 bytes
@@ -1038,15 +1526,10 @@ void Surface::Frame::MakeDescriptorResources()
 																   vk::BufferUsageFlagBits::eStorageBuffer,
 																   vk::MemoryPropertyFlagBits::eHostVisible |
 																	   vk::MemoryPropertyFlagBits::eHostCoherent);
-	object_transform_ptr	= device->vk_device.mapMemory(
-		   object_transform_buffer->vk_memory, 0, object_transform_buffer->vk_memory_info.allocationSize, vk::MemoryMapFlags());
+	object_transform_ptr	= device->buffer_manager->Get(object_transform_buffer)->mapped;
 
 	// CRITICAL FIX: Clear the GPU memory to zero
-	std::memset(object_transform_ptr, 0, object_transform_buffer->vk_memory_info.allocationSize);
-
-	object_transforms.resize(scene->objects.size());
-	for (int i = 0; i < scene->objects.size(); ++i)
-		object_transforms[i] = glm::mat4(1.0f);	   // Initialize with identity matrices
+	std::memset(object_transform_ptr, 0, device->buffer_manager->Get(object_transform_buffer)->vk_memory_info.allocationSize);
 }
 
 void Surface::Frame::AllocateDescriptorResources()
@@ -1132,21 +1615,41 @@ void Surface::Frame::Prepare(glm::mat4 camera_transforms)
 
 	std::memcpy(camera_data_ptr, &camera_data, sizeof(UniformBufferObject));
 
-	// Gather object transforms
+	// Transforms and object materials are written per instance by Surface::WriteInstances, once the frame's
+	// instances are known. Its buffers hold one entry per object, the most instances a frame can have.
 	const size_t object_count = scene->objects.size();
-	for (size_t idx = 0; idx < object_count; ++idx)
+	const size_t bytes		  = object_count * sizeof(glm::mat4);
+
+	ReserveMappedBuffer(device,
+						object_material_buffer,
+						object_material_ptr,
+						std::max<size_t>(object_count, 1) * sizeof(uint32_t),
+						vk::BufferUsageFlagBits::eStorageBuffer);
+
+	// Materials: the scene's, then the default one for objects whose index is out of range. Each frame keeps
+	// its own copy, repacked only after the scene's materials changed.
+	if (materials_version != scene->GetMaterialsVersion())
 	{
-		object_transforms[idx] = scene->objects[idx].transform;
+		const std::vector<Material>& materials		= scene->materials;
+		const size_t				 material_count = materials.size() + 1;
+		ReserveMappedBuffer(
+			device, material_buffer, material_ptr, material_count * sizeof(PackedMaterial), vk::BufferUsageFlagBits::eStorageBuffer);
+
+		auto* packed_materials = static_cast<PackedMaterial*>(material_ptr);
+		for (size_t idx = 0; idx < material_count; ++idx)
+			packed_materials[idx] = PackMaterial(materials, static_cast<uint32_t>(idx));
+		materials_version = scene->GetMaterialsVersion();
 	}
 
-	const size_t bytes = object_count * sizeof(glm::mat4);
-	std::memcpy(object_transform_ptr, object_transforms.data(), bytes);
-
-	// Update frame descriptor set (camera + transforms)
+	// Update frame descriptor set (camera + transforms, object materials + materials)
+	BufferManager*						  buffers = device->GetBufferManager();
 	std::vector<vk::DescriptorBufferInfo> buffer_infos;
 	buffer_infos.push_back(
-		vk::DescriptorBufferInfo().setBuffer(camera_data_buffer->vk_buffer).setOffset(0).setRange(sizeof(UniformBufferObject)));
-	buffer_infos.push_back(vk::DescriptorBufferInfo().setBuffer(object_transform_buffer->vk_buffer).setOffset(0).setRange(bytes));
+		vk::DescriptorBufferInfo().setBuffer(buffers->Get(camera_data_buffer)->vk_buffer).setOffset(0).setRange(sizeof(UniformBufferObject)));
+	buffer_infos.push_back(vk::DescriptorBufferInfo().setBuffer(buffers->Get(object_transform_buffer)->vk_buffer).setOffset(0).setRange(bytes));
+	buffer_infos.push_back(
+		vk::DescriptorBufferInfo().setBuffer(buffers->Get(object_material_buffer)->vk_buffer).setOffset(0).setRange(VK_WHOLE_SIZE));
+	buffer_infos.push_back(vk::DescriptorBufferInfo().setBuffer(buffers->Get(material_buffer)->vk_buffer).setOffset(0).setRange(VK_WHOLE_SIZE));
 
 	std::vector<vk::WriteDescriptorSet> descriptor_writes;
 	descriptor_writes.push_back(vk::WriteDescriptorSet()
@@ -1165,6 +1668,14 @@ void Surface::Frame::Prepare(glm::mat4 camera_transforms)
 									.setPBufferInfo(&buffer_infos[1])
 									.setPTexelBufferView(nullptr)
 									.setPImageInfo(nullptr));
+	for (uint32_t binding = 2; binding <= 3; ++binding)
+		descriptor_writes.push_back(vk::WriteDescriptorSet()
+										.setDstSet(vk_descriptor_set)
+										.setDstBinding(binding)
+										.setDstArrayElement(0)
+										.setDescriptorCount(1)
+										.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+										.setPBufferInfo(&buffer_infos[binding]));
 
 	device->vk_device.updateDescriptorSets(descriptor_writes.size(), descriptor_writes.data(), 0, nullptr);
 }
@@ -1173,43 +1684,78 @@ void Surface::Frame::Cleanup()
 {
 	if (!device)
 		NFT_ERROR(VulkanFatal, "Device pointer is null!");
-	if (vk_frame_buffer)
-		device->vk_device.destroyFramebuffer(vk_frame_buffer);
-	if (in_flight_fence)
-		device->vk_device.destroyFence(in_flight_fence);
-	if (image_available_semaphore)
-		device->vk_device.destroySemaphore(image_available_semaphore);
-	if (render_finished_semaphore)
-		device->vk_device.destroySemaphore(render_finished_semaphore);
+	// The frame may still be in flight, so its objects go through the deletion queue
+	device->GetDeletionQueue()->Push(
+		[device = device,
+		 command_pool = surface->vk_command_pool,
+		 command_buffer = vk_command_buffer,
+		 frame_buffer = vk_frame_buffer,
+		 fence = in_flight_fence,
+		 semaphore = image_available_semaphore]()
+		{
+			if (command_buffer)
+				device->vk_device.freeCommandBuffers(command_pool, command_buffer);
+			if (frame_buffer)
+				device->vk_device.destroyFramebuffer(frame_buffer);
+			if (fence)
+				device->vk_device.destroyFence(fence);
+			if (semaphore)
+				device->vk_device.destroySemaphore(semaphore);
+		});
+	// The image's last present may still wait on its render finished semaphore; that present being done also means
+	// the frame that signaled it is
+	surface->present_retirements.push_back({ presented,
+											 present_fence,
+											 [device = device, semaphore = render_finished_semaphore, fence = present_fence]()
+											 {
+												 if (semaphore)
+													 device->vk_device.destroySemaphore(semaphore);
+												 if (fence)
+													 device->vk_device.destroyFence(fence);
+											 } });
+	vk_command_buffer		  = VK_NULL_HANDLE;
+	vk_frame_buffer			  = VK_NULL_HANDLE;
+	in_flight_fence			  = VK_NULL_HANDLE;
+	image_available_semaphore = VK_NULL_HANDLE;
+	render_finished_semaphore = VK_NULL_HANDLE;
+	present_fence			  = VK_NULL_HANDLE;
+	presented				  = 0;
 	if (camera_data_buffer)
 	{
-		if (camera_data_ptr)
-		{
-			device->vk_device.unmapMemory(camera_data_buffer->vk_memory);
-			camera_data_ptr = nullptr;
-		}
+		camera_data_ptr = nullptr;
 		device->buffer_manager->DestroyBuffer(camera_data_buffer);
-		camera_data_buffer = nullptr;
+		camera_data_buffer = {};
 	}
 	if (object_transform_buffer)
 	{
-		if (object_transform_ptr)
-		{
-			device->vk_device.unmapMemory(object_transform_buffer->vk_memory);
-			object_transform_ptr = nullptr;
-		}
+		object_transform_ptr = nullptr;
 		device->buffer_manager->DestroyBuffer(object_transform_buffer);
-		object_transform_buffer = nullptr;
+		object_transform_buffer = {};
 	}
+	for (auto [buffer, mapped] : { std::pair { &object_material_buffer, &object_material_ptr },
+								   std::pair { &material_buffer, &material_ptr },
+								   std::pair { &indirect_command_buffer, &indirect_command_ptr },
+								   std::pair { &cull_object_buffer, &cull_object_ptr },
+								   std::pair { &draw_count_buffer, &draw_count_ptr } })
+	{
+		if (!*buffer)
+			continue;
+		device->buffer_manager->DestroyBuffer(*buffer);
+		*buffer = {};
+		*mapped = nullptr;
+	}
+	indirect_command_capacity = 0;
+	materials_version		  = 0;
 }
 
 //=============================================================================
 // OBJECT PICKER IMPLEMENTATION
 //=============================================================================
 
-ObjectPicker::ObjectPicker(Device* device, vk::Extent2D extent):
+ObjectPicker::ObjectPicker(Device* device, vk::Extent2D extent, VertexFormat vertex_format):
 	device(device),
 	extent(extent),
+	vertex_format(vertex_format),
 	pipeline(VK_NULL_HANDLE),
 	vk_command_pool(VK_NULL_HANDLE),
 	vk_command_buffer(VK_NULL_HANDLE),
@@ -1390,7 +1936,7 @@ void ObjectPicker::CreateShaders()
 
 void ObjectPicker::CreatePipeline()
 {
-	vertex_input_stage.Init();
+	vertex_input_stage.Init(vertex_format);
 	pipeline_info.setPVertexInputState(&vertex_input_stage.vk_vertex_input_info);
 
 	input_assembly_stage.Init(vk::PrimitiveTopology::eTriangleList);
@@ -1495,7 +2041,7 @@ uint32_t ObjectPicker::PickObject(const std::vector<ObjectData>& objects,
 										  .setImageExtent({ 1, 1, 1 });
 
 	copy_cmd.copyImageToBuffer(
-		color_attachment.vk_image, vk::ImageLayout::eTransferSrcOptimal, readback_buffer->vk_buffer, 1, &copy_region);
+		color_attachment.vk_image, vk::ImageLayout::eTransferSrcOptimal, device->buffer_manager->Get(readback_buffer)->vk_buffer, 1, &copy_region);
 
 	copy_cmd.end();
 
@@ -1505,10 +2051,8 @@ uint32_t ObjectPicker::PickObject(const std::vector<ObjectData>& objects,
 	device->vk_device.waitIdle();
 
 	// Read the object ID from the buffer
-	uint32_t* pixel_data = static_cast<uint32_t*>(
-		device->vk_device.mapMemory(readback_buffer->vk_memory, 0, readback_buffer->vk_memory_info.allocationSize));
-	uint32_t object_id = pixel_data[0];	   // R component contains object ID
-	device->vk_device.unmapMemory(readback_buffer->vk_memory);
+	uint32_t* pixel_data = static_cast<uint32_t*>(device->buffer_manager->Get(readback_buffer)->mapped);
+	uint32_t  object_id	 = pixel_data[0];	 // R component contains object ID
 
 	return object_id;
 }
@@ -1538,10 +2082,9 @@ void ObjectPicker::RecordPickingCommands(const std::vector<ObjectData>& objects,
 	command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
 
 	// Bind vertex buffer
-	vk::Buffer	 vertex_buffers[] = { geometry_batcher->vertex_buffer->vk_buffer };
+	vk::Buffer	 vertex_buffers[] = { device->buffer_manager->Get(geometry_batcher->vertex_buffer)->vk_buffer };
 	VkDeviceSize offsets[]		  = { 0 };
 	command_buffer.bindVertexBuffers(0, 1, vertex_buffers, offsets);
-	command_buffer.bindIndexBuffer(geometry_batcher->index_buffer->vk_buffer, 0, vk::IndexType::eUint32);
 
 	// TODO: Bind descriptor set with camera data (you'll need to create this)
 
@@ -1559,11 +2102,18 @@ void ObjectPicker::RecordPickingCommands(const std::vector<ObjectData>& objects,
 		auto mesh_it = geometry_batcher->mesh_data.find(object.mesh);
 		if (mesh_it != geometry_batcher->mesh_data.end())
 		{
-			const auto& mesh_data	= mesh_it->second;
-			uint32_t	index_count = static_cast<uint32_t>(mesh_data.index_size);
-			uint32_t	first_index = static_cast<uint32_t>(mesh_data.index_offset);
+			const auto& mesh_data	 = mesh_it->second;
+			int32_t		first_vertex = static_cast<int32_t>(mesh_data.offset);
+
+			// Pick against the full-detail mesh
+			if (mesh_data.lods.empty() || !geometry_batcher->index_buffer)
+			{
+				command_buffer.draw(static_cast<uint32_t>(mesh_data.size), 1, static_cast<uint32_t>(first_vertex), i);
+				continue;
+			}
 
-			command_buffer.drawIndexed(index_count, 1, first_index, 0, i);
+			command_buffer.bindIndexBuffer(device->buffer_manager->Get(geometry_batcher->index_buffer)->vk_buffer, 0, mesh_data.index_type);
+			command_buffer.drawIndexed(mesh_data.lods[0].index_count, 1, mesh_data.lods[0].first_index, first_vertex, i);
 		}
 	}
 
@@ -1605,7 +2155,7 @@ void ObjectPicker::Cleanup()
 		if (readback_buffer)
 		{
 			device->buffer_manager->DestroyBuffer(readback_buffer);
-			readback_buffer = nullptr;
+			readback_buffer = {};
 		}
 	}
 }
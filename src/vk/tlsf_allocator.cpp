@@ -0,0 +1,196 @@
+#include "vk/tlsf_allocator.h"
+
+#include <bit>
+
+namespace nft::vulkan
+{
+
+TlsfAllocator::TlsfAllocator(size_t capacity): capacity(capacity)
+{
+	for (auto& heads : free_heads)
+		heads.fill(invalid);
+
+	if (capacity > 0)
+	{
+		uint32_t node	 = NewNode(0, capacity);
+		nodes[node].free = true;
+		InsertFree(node);
+	}
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (size == 0)
+		return {};
+	if (alignment == 0)
+		alignment = 1;
+
+	// Searching for the worst case padding as well means any range found can be aligned in place
+	uint32_t node = FindFree(size + alignment - 1);
+	if (node == invalid)
+		return {};
+	RemoveFree(node);
+
+	// Padding in front of the aligned offset stays free. Its physical predecessor is in use, since free
+	// neighbours are always merged, so there is nothing to merge it with.
+	size_t offset = (nodes[node].offset + alignment - 1) / alignment * alignment;
+	if (offset > nodes[node].offset)
+	{
+		uint32_t padding				  = NewNode(nodes[node].offset, offset - nodes[node].offset);
+		nodes[padding].free				  = true;
+		nodes[padding].prev_physical	  = nodes[node].prev_physical;
+		nodes[padding].next_physical	  = node;
+		if (nodes[node].prev_physical != invalid)
+			nodes[nodes[node].prev_physical].next_physical = padding;
+		nodes[node].prev_physical = padding;
+		nodes[node].size -= offset - nodes[node].offset;
+		nodes[node].offset = offset;
+		InsertFree(padding);
+	}
+
+	// The same goes for what is left behind the allocation
+	if (nodes[node].size > size)
+	{
+		uint32_t rest				= NewNode(offset + size, nodes[node].size - size);
+		nodes[rest].free			= true;
+		nodes[rest].prev_physical	= node;
+		nodes[rest].next_physical	= nodes[node].next_physical;
+		if (nodes[node].next_physical != invalid)
+			nodes[nodes[node].next_physical].prev_physical = rest;
+		nodes[node].next_physical = rest;
+		nodes[node].size		  = size;
+		InsertFree(rest);
+	}
+
+	nodes[node].free = false;
+	used += size;
+	return { offset, node };
+}
+
+void TlsfAllocator::Free(uint32_t node)
+{
+	if (node >= nodes.size() || nodes[node].free)
+		return;
+	used -= nodes[node].size;
+	nodes[node].free = true;
+
+	// Absorb a free predecessor, then a free successor
+	uint32_t prev = nodes[node].prev_physical;
+	if (prev != invalid && nodes[prev].free)
+	{
+		RemoveFree(prev);
+		nodes[prev].size += nodes[node].size;
+		nodes[prev].next_physical = nodes[node].next_physical;
+		if (nodes[node].next_physical != invalid)
+			nodes[nodes[node].next_physical].prev_physical = prev;
+		unused_nodes.push_back(node);
+		node = prev;
+	}
+
+	uint32_t next = nodes[node].next_physical;
+	if (next != invalid && nodes[next].free)
+	{
+		RemoveFree(next);
+		nodes[node].size += nodes[next].size;
+		nodes[node].next_physical = nodes[next].next_physical;
+		if (nodes[next].next_physical != invalid)
+			nodes[nodes[next].next_physical].prev_physical = node;
+		unused_nodes.push_back(next);
+	}
+
+	InsertFree(node);
+}
+
+void TlsfAllocator::Mapping(size_t size, uint32_t& fl, uint32_t& sl)
+{
+	// Sizes below sl_count get a bin each; above, each power of two is split into sl_count steps
+	fl = static_cast<uint32_t>(std::bit_width(size)) - 1;
+	sl = fl >= sl_bits ? static_cast<uint32_t>(size >> (fl - sl_bits)) & (sl_count - 1)
+					   : static_cast<uint32_t>(size - (size_t(1) << fl));
+}
+
+uint32_t TlsfAllocator::NewNode(size_t offset, size_t size)
+{
+	Node node;
+	node.offset = offset;
+	node.size	= size;
+	if (unused_nodes.empty())
+	{
+		nodes.push_back(node);
+		return static_cast<uint32_t>(nodes.size() - 1);
+	}
+
+	uint32_t index = unused_nodes.back();
+	unused_nodes.pop_back();
+	nodes[index] = node;
+	return index;
+}
+
+void TlsfAllocator::InsertFree(uint32_t node)
+{
+	uint32_t fl, sl;
+	Mapping(nodes[node].size, fl, sl);
+
+	uint32_t head		   = free_heads[fl][sl];
+	nodes[node].prev_free  = invalid;
+	nodes[node].next_free  = head;
+	if (head != invalid)
+		nodes[head].prev_free = node;
+	free_heads[fl][sl] = node;
+
+	fl_bitmap |= uint64_t(1) << fl;
+	sl_bitmaps[fl] |= 1u << sl;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t node)
+{
+	uint32_t fl, sl;
+	Mapping(nodes[node].size, fl, sl);
+
+	uint32_t prev = nodes[node].prev_free;
+	uint32_t next = nodes[node].next_free;
+	if (prev != invalid)
+		nodes[prev].next_free = next;
+	else
+		free_heads[fl][sl] = next;
+	if (next != invalid)
+		nodes[next].prev_free = prev;
+
+	if (free_heads[fl][sl] == invalid)
+	{
+		sl_bitmaps[fl] &= ~(1u << sl);
+		if (sl_bitmaps[fl] == 0)
+			fl_bitmap &= ~(uint64_t(1) << fl);
+	}
+}
+
+uint32_t TlsfAllocator::FindFree(size_t size) const
+{
+	// Round up to the next bin boundary, so every range in the bin found is large enough
+	uint32_t fl = static_cast<uint32_t>(std::bit_width(size)) - 1;
+	if (fl >= sl_bits)
+	{
+		size_t step = (size_t(1) << (fl - sl_bits)) - 1;
+		if (size > SIZE_MAX - step)
+			return invalid;
+		size += step;
+	}
+
+	uint32_t sl;
+	Mapping(size, fl, sl);
+	if (fl >= fl_count)
+		return invalid;
+
+	uint32_t sl_map = sl_bitmaps[fl] & (~0u << sl);
+	if (sl_map == 0)
+	{
+		uint64_t fl_map = fl + 1 < fl_count ? fl_bitmap & (~uint64_t(0) << (fl + 1)) : 0;
+		if (fl_map == 0)
+			return invalid;
+		fl	   = static_cast<uint32_t>(std::countr_zero(fl_map));
+		sl_map = sl_bitmaps[fl];
+	}
+	return free_heads[fl][std::countr_zero(sl_map)];
+}
+
+}	 // namespace nft::vulkan
@@ -0,0 +1,210 @@
+#include "vk/upload_scheduler.h"
+
+#include "vk/handler.h"
+
+namespace nft::vulkan
+{
+
+UploadScheduler::UploadScheduler(Device* device): device(device)
+{
+	if (!device)
+		NFT_ERROR(VulkanFatal, "Device pointer is null in UploadScheduler constructor.");
+
+	queue			  = device->GetTransferQueue();
+	queue_family	  = device->GetQueueFamilyIndices().transfer_family.value();
+	graphics_family	  = device->GetQueueFamilyIndices().graphics_family.value();
+	timeline		  = device->SupportsTimelineSemaphores();
+	image_granularity = device->GetPhysicalDevice().getQueueFamilyProperties()[queue_family].minImageTransferGranularity;
+
+	try
+	{
+		command_pool = device->GetDevice().createCommandPool(
+			vk::CommandPoolCreateInfo()
+				.setFlags(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+				.setQueueFamilyIndex(queue_family));
+
+		if (timeline)
+		{
+			vk::SemaphoreTypeCreateInfo type_info =
+				vk::SemaphoreTypeCreateInfo().setSemaphoreType(vk::SemaphoreType::eTimeline).setInitialValue(0);
+			semaphore = device->GetDevice().createSemaphore(vk::SemaphoreCreateInfo().setPNext(&type_info));
+		}
+		else
+			wait_fence = device->CreateFence(false);
+	}
+	catch (const vk::SystemError& err)
+	{
+		NFT_ERROR(VulkanFatal, std::format("Failed To Create Upload Scheduler:\n{}", err.what()));
+	}
+
+	VulkanHandler::app->GetLogger()->Debug(std::format("Uploads run on {} queue{}",
+													   device->HasDedicatedTransferQueue() ? "a dedicated transfer" : "the graphics",
+													   timeline ? ", signaling a timeline semaphore" : ", waited for on the CPU"),
+										   "VKInit");
+}
+
+UploadScheduler::~UploadScheduler()
+{
+	WaitIdle();
+	if (semaphore)
+		device->GetDevice().destroySemaphore(semaphore);
+	if (wait_fence)
+		device->GetDevice().destroyFence(wait_fence);
+	// Destroying the pool frees its command buffers
+	if (command_pool)
+		device->GetDevice().destroyCommandPool(command_pool);
+}
+
+vk::CommandBuffer UploadScheduler::Begin()
+{
+	if (recording)
+		NFT_ERROR(VulkanFatal, "An upload is already being recorded! Submit it before beginning another.");
+
+	// Command buffers of finished submissions are reused, oldest first
+	while (!pending.empty() && IsComplete(pending.front().value))
+	{
+		free_command_buffers.push_back(pending.front().command_buffer);
+		pending.pop_front();
+	}
+
+	try
+	{
+		if (free_command_buffers.empty())
+			recording = device->GetDevice().allocateCommandBuffers(vk::CommandBufferAllocateInfo()
+																	   .setCommandPool(command_pool)
+																	   .setLevel(vk::CommandBufferLevel::ePrimary)
+																	   .setCommandBufferCount(1))[0];
+		else
+		{
+			recording = free_command_buffers.back();
+			free_command_buffers.pop_back();
+			recording.reset(vk::CommandBufferResetFlags());
+		}
+		recording.begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	}
+	catch (const vk::SystemError& err)
+	{
+		NFT_ERROR(VulkanFatal, std::format("Failed To Begin Upload Command Buffer:\n{}", err.what()));
+	}
+	return recording;
+}
+
+uint64_t UploadScheduler::Submit(vk::Fence fence)
+{
+	if (!recording)
+		NFT_ERROR(VulkanFatal, "No upload is being recorded! Call Begin() first.");
+
+	uint64_t						value		  = submitted_value + 1;
+	vk::SubmitInfo					submit_info	  = vk::SubmitInfo().setCommandBufferCount(1).setPCommandBuffers(&recording);
+	vk::TimelineSemaphoreSubmitInfo timeline_info = vk::TimelineSemaphoreSubmitInfo()
+														.setSignalSemaphoreValueCount(1)
+														.setPSignalSemaphoreValues(&value);
+	if (timeline)
+		submit_info.setSignalSemaphoreCount(1).setPSignalSemaphores(&semaphore).setPNext(&timeline_info);
+
+	try
+	{
+		recording.end();
+		// Without a timeline semaphore the submission is waited for right away, on the caller's fence if it has one
+		vk::Fence submit_fence = fence ? fence : wait_fence;
+		queue.submit(submit_info, timeline ? fence : submit_fence);
+		if (!timeline)
+		{
+			if (device->GetDevice().waitForFences(submit_fence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess)
+				NFT_ERROR(VulkanFatal, "Failed To Wait For Upload.");
+			if (submit_fence == wait_fence)
+				device->GetDevice().resetFences(wait_fence);
+			completed_value = value;
+		}
+	}
+	catch (const vk::SystemError& err)
+	{
+		NFT_ERROR(VulkanFatal, std::format("Failed To Submit Upload:\n{}", err.what()));
+	}
+
+	pending.push_back({ recording, value });
+	recording		= VK_NULL_HANDLE;
+	submitted_value = value;
+	return value;
+}
+
+void UploadScheduler::ReleaseImage(vk::CommandBuffer		 command_buffer,
+								   vk::Image				 image,
+								   vk::ImageSubresourceRange range,
+								   vk::ImageLayout			 old_layout,
+								   vk::ImageLayout			 new_layout)
+{
+	vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
+										 .setOldLayout(old_layout)
+										 .setNewLayout(new_layout)
+										 .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+										 .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+										 .setImage(image)
+										 .setSubresourceRange(range)
+										 .setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+										 .setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+
+	// On the graphics queue one transition does it; the semaphore wait makes it visible to later frames
+	if (queue_family == graphics_family)
+	{
+		command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+									   vk::PipelineStageFlagBits::eFragmentShader,
+									   vk::DependencyFlags(),
+									   nullptr,
+									   nullptr,
+									   barrier);
+		return;
+	}
+
+	// Release and acquire describe the same transition. The release's destination and the acquire's source
+	// access are ignored, the semaphore between them covers that.
+	barrier.setSrcQueueFamilyIndex(queue_family).setDstQueueFamilyIndex(graphics_family);
+	command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+								   vk::PipelineStageFlagBits::eBottomOfPipe,
+								   vk::DependencyFlags(),
+								   nullptr,
+								   nullptr,
+								   vk::ImageMemoryBarrier(barrier).setDstAccessMask(vk::AccessFlags()));
+	acquires.push_back(barrier.setSrcAccessMask(vk::AccessFlags()));
+}
+
+void UploadScheduler::RecordAcquires(vk::CommandBuffer command_buffer)
+{
+	if (acquires.empty())
+		return;
+
+	// The source stage matches the semaphore wait, so the acquire happens after the release it pairs with
+	command_buffer.pipelineBarrier(GetWaitStages(),
+								   vk::PipelineStageFlagBits::eFragmentShader,
+								   vk::DependencyFlags(),
+								   nullptr,
+								   nullptr,
+								   acquires);
+	acquires.clear();
+}
+
+bool UploadScheduler::IsComplete(uint64_t value) const
+{
+	if (!timeline)
+		return value <= completed_value;
+	return device->GetDevice().getSemaphoreCounterValue(semaphore) >= value;
+}
+
+void UploadScheduler::Wait(uint64_t value)
+{
+	if (IsComplete(value))
+		return;
+	if (device->GetDevice().waitSemaphores(vk::SemaphoreWaitInfo().setSemaphoreCount(1).setPSemaphores(&semaphore).setPValues(&value),
+										   UINT64_MAX)
+		!= vk::Result::eSuccess)
+		NFT_ERROR(VulkanFatal, "Failed To Wait For Uploads.");
+}
+
+vk::PipelineStageFlags UploadScheduler::GetWaitStages() const
+{
+	// Uploads feed vertex input (mesh data), fragment shaders (textures) and the copies that compact mesh data
+	return vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eVertexInput
+		   | vk::PipelineStageFlagBits::eFragmentShader;
+}
+
+}	 // namespace nft::vulkan
@@ -1,6 +1,7 @@
 #include "vk/util.h"
 
-#include "vk/geometry.h"	// For MaterialPushConstants
+#include "vk/deletion_queue.h"
+#include "vk/geometry.h"	// For VertexFormat
 #include "vk/handler.h"
 
 namespace nft::vulkan
@@ -10,10 +11,19 @@ namespace nft::vulkan
 // PIPELINE STAGE IMPLEMENTATIONS
 //=============================================================================
 
-void VertexInputStage::Init()
+void VertexInputStage::Init(VertexFormat vertex_format)
 {
-	binding_description	   = GetVertexInputBindingDescription();
-	attribute_descriptions = GetVertexInputAttributeDescriptions();
+	format				   = vertex_format;
+	binding_description	   = GetVertexInputBindingDescription(format);
+	attribute_descriptions = GetVertexInputAttributeDescriptions(format);
+
+	compact_vertices	   = format == VertexFormat::Compact ? VK_TRUE : VK_FALSE;
+	specialization_entry   = vk::SpecializationMapEntry().setConstantID(0).setOffset(0).setSize(sizeof(VkBool32));
+	vk_specialization_info = vk::SpecializationInfo()
+								 .setMapEntryCount(1)
+								 .setPMapEntries(&specialization_entry)
+								 .setDataSize(sizeof(VkBool32))
+								 .setPData(&compact_vertices);
 
 	vk_vertex_input_info = vk::PipelineVertexInputStateCreateInfo()
 							   .setFlags(vk::PipelineVertexInputStateCreateFlags())
@@ -192,19 +202,21 @@ void DescriptorPool::Cleanup()
 {
 	if (vk_descriptor_pool && device && device->vk_device)
 	{
-		device->vk_device.destroyDescriptorPool(vk_descriptor_pool);
+		// Sets from the pool may still be bound by frames in flight
+		device->GetDeletionQueue()->Push([device = device, pool = vk_descriptor_pool]() { device->vk_device.destroyDescriptorPool(pool); });
 		vk_descriptor_pool = VK_NULL_HANDLE;
 	}
 }
 
-void PipelineLayout::Init(std::vector<vk::DescriptorSetLayout> descriptor_set_layouts, vk::PushConstantRange push_constant_range)
+void PipelineLayout::Init(std::vector<vk::DescriptorSetLayout> descriptor_set_layouts,
+						  std::vector<vk::PushConstantRange>  push_constant_ranges)
 {
 	vk_pipeline_layout_info = vk::PipelineLayoutCreateInfo()
 								  .setFlags(vk::PipelineLayoutCreateFlags())
 								  .setSetLayoutCount(descriptor_set_layouts.size())
 								  .setPSetLayouts(descriptor_set_layouts.data())
-								  .setPushConstantRangeCount(1)
-								  .setPPushConstantRanges(&push_constant_range);
+								  .setPushConstantRangeCount(push_constant_ranges.size())
+								  .setPPushConstantRanges(push_constant_ranges.data());
 
 	try
 	{
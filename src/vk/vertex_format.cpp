@@ -0,0 +1,106 @@
+#include "vk/vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace nft::vulkan
+{
+
+uint32_t GetVertexSize(VertexFormat format)
+{
+	switch (format)
+	{
+		case VertexFormat::Compact: return sizeof(CompactVertex);
+		case VertexFormat::Full:
+		default: return MeshCache::vertex_stride * sizeof(float);
+	}
+}
+
+Bounds ComputeBounds(std::span<const float> vertices)
+{
+	Bounds bounds;
+	if (vertices.size() < MeshCache::vertex_stride)
+		return bounds;
+
+	bounds.min = bounds.max = glm::vec3(vertices[0], vertices[1], vertices[2]);
+	for (size_t i = MeshCache::vertex_stride; i + 2 < vertices.size(); i += MeshCache::vertex_stride)
+	{
+		glm::vec3 position(vertices[i], vertices[i + 1], vertices[i + 2]);
+		bounds.min = glm::min(bounds.min, position);
+		bounds.max = glm::max(bounds.max, position);
+	}
+	return bounds;
+}
+
+glm::vec4 ComputeBoundingSphere(std::span<const float> vertices, const Bounds& bounds)
+{
+	glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+	float	  radius = 0.0f;
+	for (size_t i = 0; i + 2 < vertices.size(); i += MeshCache::vertex_stride)
+	{
+		glm::vec3 offset = glm::vec3(vertices[i], vertices[i + 1], vertices[i + 2]) - center;
+		radius			 = std::max(radius, glm::dot(offset, offset));
+	}
+	return glm::vec4(center, std::sqrt(radius));
+}
+
+glm::mat4 GetDequantizeTransform(const Bounds& bounds)
+{
+	glm::vec3 extent = bounds.max - bounds.min;
+
+	glm::mat4 transform(1.0f);
+	transform[0][0] = extent.x;
+	transform[1][1] = extent.y;
+	transform[2][2] = extent.z;
+	transform[3]	= glm::vec4(bounds.min, 1.0f);
+	return transform;
+}
+
+glm::vec2 OctEncode(glm::vec3 normal)
+{
+	float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (length == 0.0f)
+		return glm::vec2(0.0f);
+
+	glm::vec2 encoded(normal.x / length, normal.y / length);
+	if (normal.z < 0.0f)
+	{
+		// Fold the lower hemisphere over the diagonals
+		glm::vec2 folded(1.0f - std::fabs(encoded.y), 1.0f - std::fabs(encoded.x));
+		encoded.x = encoded.x >= 0.0f ? folded.x : -folded.x;
+		encoded.y = encoded.y >= 0.0f ? folded.y : -folded.y;
+	}
+	return encoded;
+}
+
+void PackVertices(std::span<const float> vertices, const Bounds& bounds, VertexFormat format, void* dst)
+{
+	if (format == VertexFormat::Full)
+	{
+		if (!vertices.empty())
+			std::memcpy(dst, vertices.data(), vertices.size_bytes());
+		return;
+	}
+
+	glm::vec3 extent = bounds.max - bounds.min;
+	glm::vec3 inverse_extent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+							 extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+							 extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+	CompactVertex* packed		= static_cast<CompactVertex*>(dst);
+	size_t		   vertex_count = vertices.size() / MeshCache::vertex_stride;
+	for (size_t i = 0; i < vertex_count; i++)
+	{
+		const float* vertex	  = vertices.data() + i * MeshCache::vertex_stride;
+		glm::vec3	 position = (glm::vec3(vertex[0], vertex[1], vertex[2]) - bounds.min) * inverse_extent;
+
+		packed[i].position_xy	= glm::packUnorm2x16(glm::vec2(position.x, position.y));
+		packed[i].position_zw	= glm::packUnorm2x16(glm::vec2(position.z, 0.0f));
+		packed[i].color			= glm::packUnorm4x8(glm::vec4(vertex[3], vertex[4], vertex[5], vertex[6]));
+		packed[i].texture_coord = glm::packHalf2x16(glm::vec2(vertex[7], vertex[8]));
+		packed[i].normal		= glm::packSnorm2x16(OctEncode(glm::vec3(vertex[9], vertex[10], vertex[11])));
+	}
+}
+
+}	 // namespace nft::vulkan